@@ -2,22 +2,31 @@
  * @file AutoFeeder.ino
  * @brief Main functionality for AutoFeeder use.
  */
-#include <Servo.h>
 #include <stdint.h>
 #include "DCMotor.h"
+#include "ServoDriver.h"
+#include "ServoCalibration.h"
+#include "SerialLink.h"
+#include "LoopStats.h"
+#include "EventLog.h"
+#include "MotionStream.h"
+#include "Sensors.h"
+#include "ScoopLearning.h"
+#include "Power.h"
+#include "MotionPlanner.h"
 #include "kinematics.h"
 #include "Profile.h"
+#include "ProfileSelector.h"
 #include "Joystick.h"
+#include "StatusLed.h"
+#include "UnitState.h"
 
 // Digital Pins
 #define INPUT_PIN 2 /** Pin for mono jack button, using pull-up resistor. */
 #define DEBUG_PIN 4 /** Output pin used for debugging */
 #define SERVO_POWER_PWM 3 /** Output pin for servo power */
 #define SERVO_POWER_DIR 12 /** Output pin to set servo direction. HIGH -> +5V, LOW -> -5V */
-#define WARNING_LED_PIN 10 /** Output pin for LED. */
-// Analog Pins
-#define PROFILE_POT_PIN 5 /** Analog input pin for potentiometer */
-#define SERVO_VOLTAGE_PIN 4 /** Analog input pin for voltage divider */
+// Analog Pins: the profile potentiometer is read by ProfileSelector
 
 // Lengths of linkages, in mm
 const float L1 = 100.0; /** Length of linkage 1 in mm */
@@ -26,43 +35,68 @@ const float L2 = 100.0; /** Distance to tip of the spoon in mm */
 // Constants
 #define Q_EPSILON 0.00001 /** Two angles are considered equal if their absolute difference is less than this value */
 #define DIST_EPSILON 0.001 /** Two points are considered at the same position if they are this close */
-// If servos are not moving from 0 to 180 degrees, then change these values
-#define SERVO_MIN_PW 544 /** Minimum pulse width for servos in microseconds */
-#define SERVO_MAX_PW 2400 /** Maximum pulse width for servos in microseconds */
-// Fine adjustment for servo alignment. These might need to be adjusted if servos are severely misaligned.
-#define SERVO1_TRIM 0
-#define SERVO2_TRIM 0
+// Servo alignment is set with servo_calibration_mode, see ServoCalibration.h for the default pulse widths.
+#define SERVO_CAL_ADJUST_INTERVAL 20 /** Milliseconds between pulse width adjustments while the joystick is held during servo calibration */
 
 #define MAX_JOINT_SPEED 0.0003 /** Max speed of servos in radians per step. Step duration is depenent on code performance. */
 #define DC_MOTOR_SPEED 255 /** Speed of the DC motor, from 0-255. */
 
 #define IK_STEP_SIZE 0.25 /** Distance stepped by each IK step during scoop, in mm */
+#define JOG_MAX_SPEED 40 /** Spoon speed in calibration_mode with the joystick fully deflected, in mm/s */
+#define JOG_MAX_ACCEL 200 /** Acceleration of the spoon in calibration_mode, in mm/s^2 */
 // Current sensing, at 1.65 V / A, or 337.6 units / A from analogRead
 #define THRESHOLD_CURRENT 400 /** If servo current draw exceeds this value, then scooping will restart with a vertical offset. */
 #define OVERLOAD_CURRENT 500 /** If servo current draw exceeds this value, then scooping will cancel. */
-// Battery voltage sensing
-// If supplied voltage drops below this value, then there is not enough power to drive the motors.
-#define LOW_POWER_VOLTAGE 662 // ((7.4V * 0.875))/2) * 1023/5 = 662, 7.4V is battery voltage, 0.875 is voltage cutoff ratio, 1023/5 remaps from voltage to analogRead value.
 
 #define ROTATE_PLATE_TIME 500 /** Minimum number of ms to hold input down until plate rotates. */
 
+#define TELEMETRY_INTERVAL 50 /** Milliseconds between telemetry frames sent over SerialLink after reset, 0 for none. The host can change it with FRAME_CMD_TELEMETRY. */
+#define STREAM_MAX_STEP_TIME 20000 /** Longest time in microseconds that one stream_mode step moves the joints for, so a stalled loop does not cause a jump */
+#define HOST_MODE_TIMEOUT 10000 /** A transaction ends by itself if no command arrives for this many ms */
+#define LOOP_STATS_DUMP_TIME 2000 /** Holding input this long in feed_wait_step dumps loop statistics (when LOOP_STATS is enabled) */
+
 // GLOBAL VARIABLES
-Profile profile = profiles[0];  // Stores the keypoints of the currently selected profile
-int profile_idx = 0;            // Stores the index of the selected profile in the list of profiles
-unsigned long timestamp;        // Used for various timing-based events
-Servo j1, j2;                   // Servo joints
-uint16_t X_CENTER, Y_CENTER;    // Joystick calibration
-float q1 = 0;                   // current q1 position
-float q2 = 0;                   // current q2 position
-float q1_speed = 0;             // current q1 speed
-float q2_speed = 0;             // current q2 speed
-float fk_target_q1 = 0;         // target q1 position
-float fk_target_q2 = 0;         // target q2 position
-float ik_target_x = L1 + L2;    // target x
-float ik_target_y = 0;          // target y
-size_t fk_step = 0;             // keeps track of forward kinematics progress
-size_t ik_step = 0;             // keeps track of inverse kinematics progress
-uint8_t prev_profile_idx = 0;   // keeps track of the previous profile index to detect when the selection changes
+UNIT_STATE const Profile &profile = active_profile();  // Keypoints of the selected profile, owned by the profile store
+UNIT_STATE unsigned long host_command_time = 0;  // millis() of the last command received from the host
+UNIT_STATE unsigned long timestamp;        // Used for various timing-based events
+UNIT_STATE uint16_t X_CENTER, Y_CENTER;    // Joystick calibration
+UNIT_STATE float q1 = 0;                   // current q1 position
+UNIT_STATE float q2 = 0;                   // current q2 position
+UNIT_STATE float q1_speed = 0;             // current q1 speed
+UNIT_STATE float q2_speed = 0;             // current q2 speed
+UNIT_STATE float fk_target_q1 = 0;         // target q1 position
+UNIT_STATE float fk_target_q2 = 0;         // target q2 position
+UNIT_STATE JointMove joint_move;           // Planned move to fk_target_q1, fk_target_q2
+UNIT_STATE LineMove line_move;             // Planned straight line move of the spoon tip
+UNIT_STATE bool line_moving = false;       // True if line_move is running, false if it fell back to joint_move
+UNIT_STATE unsigned long move_start = 0;   // micros() when joint_move or line_move started
+UNIT_STATE float ik_target_x = L1 + L2;    // target x
+UNIT_STATE float ik_target_y = 0;          // target y
+UNIT_STATE size_t fk_step = 0;             // keeps track of forward kinematics progress
+UNIT_STATE size_t ik_step = 0;             // keeps track of inverse kinematics progress
+UNIT_STATE unsigned long loop_start = 0;   // micros() at the start of the current loop iteration
+UNIT_STATE uint16_t loop_us = 0;           // duration of the previous loop iteration in microseconds
+UNIT_STATE unsigned long telemetry_time = 0;  // millis() when the last telemetry frame was sent
+UNIT_STATE uint16_t telemetry_interval = TELEMETRY_INTERVAL;  // ms between telemetry frames, 0 when telemetry is off
+UNIT_STATE StreamSetpoint stream_target;   // Setpoint stream_mode is moving to, in mrad
+UNIT_STATE float stream_from_q1 = 0;       // q1 when the current stream setpoint was started
+UNIT_STATE float stream_from_q2 = 0;       // q2 when the current stream setpoint was started
+UNIT_STATE unsigned long stream_start = 0; // millis() when the current stream setpoint was started
+UNIT_STATE unsigned long stream_step_time = 0;  // micros() of the previous joint step in stream_mode
+UNIT_STATE bool stream_moving = false;     // False while stream_mode holds position waiting for setpoints
+
+/**
+ * Payload of a FRAME_TELEMETRY frame. tools/telemetry_decode.py must be updated if this changes.
+ */
+typedef struct TelemetryFrame {
+  uint16_t time_ms;        // Low 16 bits of millis()
+  int16_t q1, q2;          // Joint positions in mrad
+  int16_t ik_x, ik_y;      // IK target in 0.1 mm
+  uint16_t servo_current;  // Servo current sense (A0), in analogRead units
+  uint16_t motor_current;  // DC motor current sense (A1), in analogRead units
+  uint8_t mode;            // Index of the current mode in MODES
+  uint16_t loop_us;        // Duration of the previous loop iteration in microseconds
+} TelemetryFrame;
 
 #pragma region Step Code
 /**
@@ -146,56 +180,75 @@ int step_joint_positions(float q1_target, float q2_target, float q1_max_step, fl
 }
 
 /**
- * @brief Finds speeds for which joints 1 and 2 will reach their targets at the same time.
- * @note If target is very close to current position, speeds will be set to maximum to avoid dividing by zero.
- * @param q1_target Target for q1.
- * @param q2_target Target for q2.
- * @param max_speed Maximum speed of rotation.
- * @param q1_speed Reference to q1_speed, which will be set by this function.
- * @param q2_speed Reference to q2_speed, which will be set by this function.
- */
-void balance_speed(float q1_target, float q2_target, float max_speed, float &q1_speed, float &q2_speed) {
-  // Finds speeds at which both q1 and q2 will reach their target at the same time.
-  // If one of the joint speeds is very close to 0, then both speeds are just set to the maximum.
-
-  // Make the target store the difference between the current and target (the delta), then make the value positive
-  q1_target -= q1;
-  if (q1_target < 0) q1_target = -q1_target;
-  q2_target -= q2;
-  if (q2_target < 0) q2_target = -q2_target;
-
-  // If either value is too small, just use max speed.
-  if (q1_target < Q_EPSILON || q2_target < Q_EPSILON) {
-    q1_speed = max_speed;
-    q2_speed = max_speed;
-    return;
-  }
-  // Find which delta is larger and set that speed to maximum.
-  // Then, set the smaller delta's speed to the ratio of max_speed*big_delta/small_delta.
-  if (q1_target > q2_target) {
-    q1_speed = max_speed;
-    q2_target /= q1_target;
-    if (q2_target < Q_EPSILON) {
-      q2_speed = max_speed;
-    } else {
-      q2_speed = max_speed * q2_target;
-    }
-  } else {
-    q2_speed = max_speed;
-    q1_target /= q2_target;
-    if (q1_target < Q_EPSILON) {
-      q1_speed = max_speed;
-    } else {
-      q1_speed = max_speed * q1_target;
-    }
+ * @brief Sets fk_target_q1 and fk_target_q2 to the IK solution for a point, choosing the elbow branch nearest the current joints.
+ * If the point has no solution within the servo ranges, the targets are set to the current joints so the arm holds still.
+ * @return IK_OK, IK_UNREACHABLE or IK_JOINT_LIMIT, as from solve_ik.
+ */
+uint8_t set_joint_targets(float x, float y) {
+  uint8_t result = solve_ik(x, y, q1, q2, fk_target_q1, fk_target_q2);
+  if (result != IK_OK) {
+    fk_target_q1 = q1;
+    fk_target_q2 = q2;
+  }
+  return result;
+}
+
+/**
+ * @brief Plans a move from the current joint positions to fk_target_q1, fk_target_q2, and starts it.
+ * @param scale Speed of the move relative to the joint limits in MotionPlanner.h
+ * @see step_joint_move MotionPlanner::plan
+ */
+void start_joint_move(float scale) {
+  MotionPlanner::plan(joint_move, q1, q2, fk_target_q1, fk_target_q2, scale);
+  move_start = micros();
+}
+
+/**
+ * @brief Sets q1 and q2 to where the move started by start_joint_move should be now.
+ * @returns 1 if the move is done, 0 otherwise.
+ */
+int step_joint_move() {
+  return MotionPlanner::sample(joint_move, (micros() - move_start) * 1e-6, q1, q2);
+}
+
+/**
+ * @brief Plans a straight line move of the spoon tip from where it is to a point, and starts it.
+ * If part of the line cannot be reached, falls back to a joint move to fk_target_q1, fk_target_q2, which must be set to the same point.
+ * @param scale Speed of the move relative to the limits in MotionPlanner.h
+ * @param accel Acceleration limit of the spoon tip, in mm/s^2
+ * @param jerk Jerk limit of the spoon tip, in mm/s^3, or 0 for none
+ * @see step_line_move MotionPlanner::plan_line
+ */
+void start_line_move(float x, float y, float scale, float accel, float jerk) {
+  float x_from, y_from;
+  calc_fk(q1, q2, x_from, y_from);
+  line_moving = MotionPlanner::plan_line(line_move, x_from, y_from, x, y, q1, q2, scale, accel, jerk);
+  if (!line_moving) {
+    start_joint_move(scale);
+    ik_target_x = x;
+    ik_target_y = y;
+  }
+  move_start = micros();
+}
+
+/**
+ * @brief Sets ik_target_x, ik_target_y, q1 and q2 to where the move started by start_line_move should be now.
+ * @returns 1 if the move is done, 0 otherwise.
+ */
+int step_line_move() {
+  if (!line_moving) {
+    return step_joint_move();
   }
+  int done = MotionPlanner::sample_line(line_move, (micros() - move_start) * 1e-6, ik_target_x, ik_target_y);
+  solve_ik(ik_target_x, ik_target_y, q1, q2, q1, q2);  // The line was checked when planned, and q1, q2 hold if not
+  return done;
 }
 #pragma endregion
 
 // MODES
-void (*cur_mode)();                   // The current code to execute in the main loop
-volatile void (*next_mode)() = NULL;  // Allows interrupts to change the mode (volatile = must reference RAM, so slower but fewer race conditions)
-bool pre = false;                     // True if the mode is just entered
+UNIT_STATE void (*cur_mode)();                   // The current code to execute in the main loop
+UNIT_STATE void (*volatile next_mode)() = NULL;  // Allows interrupts to change the mode (volatile = must reference RAM, so slower but fewer race conditions)
+UNIT_STATE bool pre = false;                     // True if the mode is just entered
 
 /**
  * Switch to the new mode only if another section of code has not yet requested to switch during this loop.
@@ -220,25 +273,52 @@ void force_switch_mode(void (*new_mode)()) {
 void move_home_then_wait();  // Moves the servos back to the home position, then switches to wait_mode.
 void wait_mode();            // Waits for user input, then goes into the rotate plate step or calibration mode depending on the input.
 void calibration_mode();     // Sets keypoints for differently shaped plates and bowls
+void servo_calibration_mode();  // Builds the angle to pulse width tables for both servos
 void low_power_mode();       // Blinks the warning LED and waits for the robot to be powered off.
 
 void rotate_plate_step();  // Rotates the plate at a slow speed. On user input, stop the plate and switch to descend step.
 void descend_step();       // Descends to edge of plate. Once motion is complete, switch to scoop step.
 void scoop_step();         // Scrapes across plate. Once motion is complete, switch to pre lift step.
-void lift_step_fk();       // Lifts spoon up to user with forward kinematics (sets joint states directly)
+void lift_step_fk();       // Lifts spoon up to user along a straight line, ending with the arm straight out
 void feed_wait_step();     // Waits for user to eat the food. Switches to return step on user input.
 void return_step();        // Moves arm back to starting position, then switches to wait mode.
+void cancel_scoop_up_step();   // Moves straight up out of the plate when a scoop is interrupted.
+void cancel_scoop_out_step();  // Finishes an interrupted scoop at the exit point, then lifts.
+void host_mode();              // Holds the arm still while the host writes to EEPROM.
+void stream_mode();            // Follows setpoints streamed by the host.
+
+// Every mode, in the order used for mode ids in telemetry. Append new modes to the end so host tools keep working.
+void (*const MODES[])() PROGMEM = {
+  move_home_then_wait, wait_mode, calibration_mode, servo_calibration_mode, low_power_mode,
+  rotate_plate_step, descend_step, scoop_step, lift_step_fk, feed_wait_step, return_step,
+  cancel_scoop_up_step, cancel_scoop_out_step, host_mode, stream_mode
+};
+#define NUM_MODES (sizeof(MODES) / sizeof(MODES[0]))
+UNIT_STATE uint8_t cur_mode_id = 0;  // Index of cur_mode in MODES
+
+/**
+ * @param mode Mode function
+ * @return Index of the mode in MODES, or NUM_MODES if it is not listed.
+ */
+uint8_t mode_id(void (*mode)()) {
+  for (uint8_t i = 0; i < NUM_MODES; i++) {
+    if ((void (*)())pgm_read_ptr(&MODES[i]) == mode) return i;  // MODES is in flash
+  }
+  return NUM_MODES;
+}
 
 // CODE
 
 /**
- * Enters low power mode if the voltage measured at SERVO_VOLTAGE_PIN is below LOW_POWER_VOLTAGE.
- * @see switch_mode
+ * Enters low power mode if the battery is too low, judged on its estimated resting voltage so that sag during fast moves does not trip it.
+ * @see switch_mode Power::low
  * @return true if switching to low power, false otherwise.
  */
 bool check_low_power() {
-  int val = analogRead(SERVO_VOLTAGE_PIN);
-  if (val < LOW_POWER_VOLTAGE) {
+  if (Power::low()) {
+    if (next_mode != low_power_mode && cur_mode != low_power_mode) {
+      EventLog::log(EVENT_LOW_POWER, cur_mode_id, Power::current(), Power::voltage());
+    }
     switch_mode(low_power_mode);
     return true;
   }
@@ -247,10 +327,10 @@ bool check_low_power() {
 
 /**
  * Initial setup for the device, including setting pin modes, loading profiles, and calibrating the joystick.
- * @see load_profile write_servos
+ * @see load_profiles write_servos
  */
 void setup() {
-  // Serial.begin(9600);
+  SerialLink::begin();                         // Telemetry and host commands
   pinMode(DEBUG_PIN, OUTPUT);                  // For oscilloscope debugging
   pinMode(INPUT_PIN, INPUT_PULLUP);            // Button input for scooping
   pinMode(JOYSTICK_BUTTON_PIN, INPUT_PULLUP);  // Used for calibration
@@ -258,23 +338,24 @@ void setup() {
   digitalWrite(SERVO_POWER_DIR, HIGH);
   pinMode(SERVO_POWER_PWM, OUTPUT);    // Motor enable A -> power for servos
   digitalWrite(SERVO_POWER_PWM, LOW);  // Disable servos during initialization
-  pinMode(WARNING_LED_PIN, OUTPUT);
-  digitalWrite(WARNING_LED_PIN, LOW);
+  StatusLed::begin();  // Takes the Timer0 compare A interrupt to play LED patterns
   // Attach all motors
-  j1.attach(5);
-  j2.attach(6);
+  ServoDriver::attach();  // Takes Timer1 to drive pins 5 and 6
+  ServoCalibration::load();
   DCMotor::attach();  // Sets pins 8, 11, 13 for Motor B brake, enable, and direction
   DCMotor::set_brake(false);
   DCMotor::set_direction(false);
   cur_mode = lift_step_fk;  // Start the robot by moving to the zero position
+  cur_mode_id = mode_id(cur_mode);
   pre = true;
-  // Load profiles from EEPROM
-  for (int i = 0; i < NUM_PROFILES; i++) {
-    load_profile(i, profiles[i]);
+  EventLog::begin();
+  // Load profiles from EEPROM, replacing any that are missing or corrupted with defaults
+  if (!load_profiles()) {
+    EventLog::log(EVENT_PROFILES_REPAIRED, cur_mode_id, 0, 0);
   }
   // Set profile to current selection
-  prev_profile_idx = check_profile_choice();
-  profile = profiles[prev_profile_idx];
+  ProfileSelector::begin();
+  select_profile(ProfileSelector::choice());
   // When the servos turn on, they snap to their start position at full speed
   // So, this position is one that is unlikely to hit an obstacle.
   write_servos(-2.09, 2.09);            // This is -120 and 120 degrees, making an equilateral triangle.
@@ -282,103 +363,304 @@ void setup() {
   timestamp = millis();
   // Give servos time to reach their target before starting the main loop
   while (millis() < timestamp + 500) {
+    Power::update();
     if (check_low_power()) {
       break;
     }
   }
   // Setup joystick center after servos receive power to ensure electrical noise matches regular operating conditions
-  X_CENTER = analogRead(JOY_X_PIN);
-  Y_CENTER = analogRead(JOY_Y_PIN);
+  calibrate_joystick();
+}
+
+/**
+ * Sends one telemetry frame. Telemetry is dropped rather than delaying the loop if the serial buffer is full.
+ * @see SerialLink::send
+ */
+void send_telemetry() {
+  TelemetryFrame frame;
+  frame.time_ms = millis();
+  frame.q1 = q1 * 1000;
+  frame.q2 = q2 * 1000;
+  frame.ik_x = ik_target_x * 10;
+  frame.ik_y = ik_target_y * 10;
+  frame.servo_current = Sensors::servo_current();
+  frame.motor_current = Sensors::motor_current();
+  frame.mode = cur_mode_id;
+  frame.loop_us = loop_us;
+  SerialLink::send(FRAME_TELEMETRY, &frame, sizeof(frame));
+}
+
+/**
+ * Converts a streamed setpoint to joint angles in mrad, in place.
+ * Cartesian points are constrained to the workspace, and joint angles to the servo ranges.
+ * @param flags STREAM_* flags of the frame
+ * @return False if the point has no inverse kinematics solution.
+ */
+bool stream_setpoint_to_joints(uint8_t flags, StreamSetpoint &sp) {
+  float sq1, sq2;
+  if (flags & STREAM_JOINT) {
+    sq1 = constrain(sp.a * 0.001, -PI, 0);
+    sq2 = constrain(sp.b * 0.001, 0, PI);
+  } else {
+    float x = sp.a * (1.0 / PROFILE_UNITS_PER_MM);
+    float y = sp.b * (1.0 / PROFILE_UNITS_PER_MM);
+    constrain_ik_point(x, y);
+    if (!calc_ik(x, y, sq1, sq2)) return false;
+  }
+  sp.a = lround(sq1 * 1000);
+  sp.b = lround(sq2 * 1000);
+  return true;
+}
+
+/**
+ * Replies to a host command that returns no data.
+ */
+void send_ack(uint8_t command, uint8_t status) {
+  uint8_t payload[2] = { command, status };
+  SerialLink::send_wait(FRAME_ACK, payload, sizeof(payload));
+}
+
+/**
+ * Handles frames received from the host.
+ * Reads are answered in any mode. Commands that write EEPROM are only accepted inside a transaction (host_mode), so they never stall motion.
+ * @see SerialLink::receive host_mode
+ */
+void check_host_commands() {
+  uint8_t type, len;
+  const uint8_t *payload;
+  while (SerialLink::receive(type, payload, len)) {
+    host_command_time = millis();
+    bool in_transaction = (cur_mode == host_mode || next_mode == host_mode);
+    bool streaming = (cur_mode == stream_mode || next_mode == stream_mode);
+    // Commands that wait on EEPROM or on serial output are only answered while the arm is still
+    bool idle = in_transaction || (cur_mode == wait_mode && next_mode == NULL);
+    switch (type) {
+      case FRAME_CMD_LOOP_STATS:
+        LoopStats::dump();
+        if (len > 0 && payload[0]) LoopStats::reset();
+        break;
+      case FRAME_CMD_EVENT_LOG:
+        if (!idle) {
+          send_ack(type, ACK_BUSY);
+          break;
+        }
+        EventLog::dump();
+        if (len > 0 && payload[0]) EventLog::clear();
+        break;
+      case FRAME_CMD_LIST: {
+        uint8_t reply[1 + NUM_PROFILES];
+        reply[0] = ProfileSelector::choice();
+        for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+          Profile p;
+          reply[1 + i] = load_profile(i, p) ? p.num_points : 0;
+        }
+        SerialLink::send_wait(FRAME_PROFILE_LIST, reply, sizeof(reply));
+        break;
+      }
+      case FRAME_CMD_READ_PROFILE: {
+        Profile p;
+        if (len != 1 || !load_profile(payload[0], p)) {
+          send_ack(type, ACK_BAD_REQUEST);
+          break;
+        }
+        static_assert(1 + PROFILE_ENCODED_MAX <= FRAME_MAX_PAYLOAD, "A profile must fit in one frame");
+        uint8_t reply[1 + PROFILE_ENCODED_MAX];
+        reply[0] = payload[0];
+        uint8_t n = encode_profile(p, reply + 1);
+        SerialLink::send_wait(FRAME_PROFILE, reply, 1 + n);
+        break;
+      }
+      case FRAME_CMD_WRITE_PROFILE: {
+        Profile p;
+        if (!in_transaction) send_ack(type, ACK_BUSY);
+        else if (len < 1 || payload[0] >= NUM_PROFILES || !decode_profile(payload + 1, len - 1, p)) send_ack(type, ACK_BAD_REQUEST);
+        else if (!save_profile(p, payload[0])) send_ack(type, ACK_WRITE_FAILED);
+        else {
+          ScoopLearning::forget(payload[0]);
+          send_ack(type, ACK_OK);
+        }
+        break;
+      }
+      case FRAME_CMD_ACTIVATE:
+        if (len != 1 || payload[0] >= NUM_PROFILES) {
+          send_ack(type, ACK_BAD_REQUEST);
+          break;
+        }
+        // Swapping the profile mid-scoop would change the path being followed, drop calibration edits, and save learned offsets to EEPROM
+        if (!idle) {
+          send_ack(type, ACK_BUSY);
+          break;
+        }
+        ProfileSelector::host_select(payload[0]);
+        select_profile(payload[0]);
+        send_ack(type, ACK_OK);
+        break;
+      case FRAME_CMD_READ_CAL: {
+        if (len != 1 || payload[0] > 1) {
+          send_ack(type, ACK_BAD_REQUEST);
+          break;
+        }
+        uint8_t reply[1 + SERVO_CAL_POINTS * sizeof(uint16_t)];
+        reply[0] = payload[0];
+        for (uint8_t i = 0; i < SERVO_CAL_POINTS; i++) {
+          uint16_t pw = ServoCalibration::get_point(payload[0], i);
+          memcpy(reply + 1 + i * sizeof(uint16_t), &pw, sizeof(uint16_t));
+        }
+        SerialLink::send_wait(FRAME_SERVO_CAL, reply, sizeof(reply));
+        break;
+      }
+      case FRAME_CMD_WRITE_CAL:
+        if (!in_transaction) send_ack(type, ACK_BUSY);
+        else if (len != 1 + SERVO_CAL_POINTS * sizeof(uint16_t) || payload[0] > 1) send_ack(type, ACK_BAD_REQUEST);
+        else {
+          for (uint8_t i = 0; i < SERVO_CAL_POINTS; i++) {
+            uint16_t pw;
+            memcpy(&pw, payload + 1 + i * sizeof(uint16_t), sizeof(uint16_t));
+            ServoCalibration::set_point(payload[0], i, pw);
+          }
+          bool saved = ServoCalibration::save();
+          if (!saved) ServoCalibration::load();  // Rejected tables must not stay in use
+          send_ack(type, saved ? ACK_OK : ACK_WRITE_FAILED);
+        }
+        break;
+      case FRAME_CMD_BEGIN:
+        if (idle) {
+          force_switch_mode(host_mode);
+          send_ack(type, ACK_OK);
+        } else {
+          send_ack(type, ACK_BUSY);
+        }
+        break;
+      case FRAME_CMD_END:
+        if (in_transaction) {
+          select_profile(ProfileSelector::choice());
+          switch_mode(wait_mode);
+        } else if (streaming) {
+          MotionStream::clear();
+          force_switch_mode(move_home_then_wait);
+        }
+        send_ack(type, ACK_OK);
+        break;
+      case FRAME_CMD_STREAM: {
+        if (len < 1 || (len - 1) % sizeof(StreamSetpoint) != 0) {
+          send_ack(type, ACK_BAD_REQUEST);
+          break;
+        }
+        if (!streaming) {
+          if (cur_mode != wait_mode || next_mode != NULL) {
+            send_ack(type, ACK_BUSY);
+            break;
+          }
+          MotionStream::clear();
+          force_switch_mode(stream_mode);
+        }
+        StreamStatus status;
+        status.accepted = 0;
+        for (uint8_t i = 0; i < (len - 1) / sizeof(StreamSetpoint); i++) {
+          StreamSetpoint sp;
+          memcpy(&sp, payload + 1 + i * sizeof(StreamSetpoint), sizeof(StreamSetpoint));
+          if (MotionStream::space() == 0 || !stream_setpoint_to_joints(payload[0], sp)) break;
+          MotionStream::push(sp);
+          status.accepted++;
+        }
+        status.space = MotionStream::space();
+        status.underruns = MotionStream::underruns();
+        SerialLink::send_wait(FRAME_STREAM_STATUS, &status, sizeof(status));
+        break;
+      }
+      case FRAME_CMD_TELEMETRY:
+        if (len != sizeof(telemetry_interval)) {
+          send_ack(type, ACK_BAD_REQUEST);
+          break;
+        }
+        memcpy(&telemetry_interval, payload, sizeof(telemetry_interval));
+        telemetry_time = millis();
+        send_ack(type, ACK_OK);
+        break;
+      default:
+        send_ack(type, ACK_BAD_REQUEST);
+        break;
+    }
+  }
 }
 
 /**
  * Arduino main loop, which executes the current mode function on repeat.
- * Also checks for switching profiles.
- * @see check_profile_choice
+ * Also checks for switching profiles and host commands, records loop timing, writes queued events, and sends telemetry every telemetry_interval ms.
+ * @see ProfileSelector
  * @see switch_mode
+ * @see send_telemetry
+ * @see LoopStats
  */
 void loop() {
+  unsigned long now = micros();
+  loop_us = min(now - loop_start, 0xFFFFUL);
+  loop_start = now;
+  LoopStats::record(cur_mode_id, loop_us);  // cur_mode_id is still the mode of the iteration that was measured
   if (next_mode != NULL) {
     cur_mode = next_mode;
+    cur_mode_id = mode_id(cur_mode);
     next_mode = NULL;
     pre = true;
   }
+  Power::update();
   cur_mode();
   pre = false;
-  // Every 0.1s, check if the profile choice has changed. If so, blink the LED.
-  if ((millis() % 100) == 0) {
-    uint8_t val = check_profile_choice();
-    if (val != prev_profile_idx) {
-      prev_profile_idx = val;
-      digitalWrite(WARNING_LED_PIN, HIGH);
-      delay(25);
-      digitalWrite(WARNING_LED_PIN, LOW);
-    }
-    // Serial.println(analogRead(4));
+  // Blink the LED when the profile choice changes
+  ProfileSelector::update();
+  if (ProfileSelector::changed()) {
+    StatusLed::play(LED_PATTERN_SELECT, 1);
+  }
+  check_host_commands();
+  EventLog::service();
+  if (telemetry_interval > 0 && millis() - telemetry_time >= telemetry_interval) {
+    telemetry_time = millis();
+    send_telemetry();
   }
 }
 
 #pragma region Servo Control
 /**
- * Linearly interpolates from (-pi/2 pi/2) -> (SERVO_MIN_PW SERVO_MAX_PW)
- * @param q
- */
-int map_q_to_pulse_width(float q) {
-  // See https://www.desmos.com/calculator/jx9jmkxbzo
-  // y = mx + b, where x is an angle from [-pi/2, pi/2], y is a pulse width from SERVO_MIN_PW to SERVO_MAX_PW
-  // m = ((SERVO_MAX_PW - SERVO_MIN_PW)/(PI))
-  // y1 = m*x1 + b -> b = y1 - m*x1
-  // b = (SERVO_MIN_PW - (m*(-PI/2)))
-  // constexpr to force compiler to do this math at compile time instead of runtime
-  constexpr float m = ((SERVO_MAX_PW - SERVO_MIN_PW) / (PI));
-  constexpr float b = (SERVO_MIN_PW - (m * (-PI / 2)));
-  return m * q + b;
-}
-
-/**
- * Writes the joint angle to the j1 servo, and to the global variable q1 to keep track of the motor's current position.
- * @param in_q1 The joint angle to write, in radians. Angle should be in range -PI to 0.
+ * Writes both servos in one update, and to the global variables q1 and q2 to keep track of the motors' current positions.
+ * The two pulse widths are applied in the same servo frame, so the joints never receive a half-updated pose.
+ * @param in_q1 Servo 1 angle, in range -PI to 0 radians
+ * @param in_q2 Servo 2 angle, in range 0 to PI radians
+ * @see ServoDriver::write
  */
-void write_q1(float in_q1) {
-  // J1 from -PI to 0
-  j1.writeMicroseconds(map_q_to_pulse_width(-in_q1 - PI * 0.5) + (SERVO1_TRIM));
+void write_servos(float in_q1, float in_q2) {
+  // Servo angles are -PI/2 to PI/2, which is 0 to SERVO_CAL_RANGE in calibration units.
+  // J1 from -PI to 0: servo angle = -q1 - PI/2, so units = -q1 * units_per_rad
+  // J2 from 0 to PI: servo angle = PI/2 - q2, so units = (PI - q2) * units_per_rad
+  constexpr float units_per_rad = SERVO_CAL_RANGE / PI;
+  ServoDriver::write(
+    ServoCalibration::pulse_width(0, -in_q1 * units_per_rad),
+    ServoCalibration::pulse_width(1, (PI - in_q2) * units_per_rad));
   q1 = in_q1;
-}
-
-/**
- * Writes the joint angle to the j2 servo, and to the global variable q2 to keep track of the motor's current position.
- * @param in_q2 The joint angle to write, in radians. Angle should be in range 0 to PI.
- */
-void write_q2(float in_q2) {
-  // J2 from 0 to PI
-  j2.writeMicroseconds(map_q_to_pulse_width(-in_q2 + PI * 0.5) + (SERVO2_TRIM));
   q2 = in_q2;
 }
+#pragma endregion
 
 /**
- * Writes to both servo 1 and 2 in one function call.
- * @param in_q1 Servo 1 angle, in range -PI to 0 radians
- * @param in_q2 Servo 2 angle, in range 0 to PI radians
- * @see write_q1 write_q2
+ * Makes a profile the one to scoop with, along with its learned scoop offsets. Nothing is read from EEPROM if it already is.
+ * @see activate_profile ScoopLearning::select
  */
-void write_servos(float in_q1, float in_q2) {
-  write_q1(in_q1);
-  write_q2(in_q2);
+void select_profile(uint8_t idx) {
+  activate_profile(idx);
+  ScoopLearning::select(idx);
 }
-#pragma endregion
 
 /**
- * Checks profile potentiometer for the user's current selection. Returns a profile index depending on the measured voltage.
- * @returns A profile index in range 0 to 3
+ * Steps the profile bank on a joystick flick to the left or right, then blinks the LED once per bank number (1 to NUM_PROFILE_BANKS).
+ * @see ProfileSelector
  */
-int check_profile_choice() {
-  // Average difference between division centers: 146
-  // Center of profile 1: 476
-  int val = analogRead(PROFILE_POT_PIN);
-  int idx = (val - (476 - 146 / 2)) / 146;  // Subtract half a width to start at the "left" of profile 1 instead of the center.
-  if (idx < 0) idx = 0;
-  if (idx > 3) idx = 3;
-  return idx;
+void check_profile_bank() {
+  static UNIT_STATE int prev_joy_x = 0;
+  int joy_x = read_joystick_x();
+  if (joy_x != 0 && prev_joy_x == 0) {
+    ProfileSelector::set_bank(ProfileSelector::bank() + NUM_PROFILE_BANKS + joy_x);
+    StatusLed::play(LED_PATTERN_COUNT, ProfileSelector::bank() + 1);
+  }
+  prev_joy_x = joy_x;
 }
 
 /**
@@ -391,66 +673,92 @@ void move_home_then_wait() {
   }
   timestamp = millis();
   if (fk_step == 0) {
-    int ik_done = step_ik_target(HOME_X, HOME_Y, IK_STEP_SIZE);
+    int ik_done = step_ik_target(HOME_X, HOME_Y, IK_STEP_SIZE * Power::speed_scale());
     if (ik_done) {
       write_servos(Q1_HOME, Q2_HOME);
       ik_target_x = HOME_X;
       ik_target_y = HOME_Y;
       switch_mode(wait_mode);
     }
-    bool ik_success = calc_ik(ik_target_x, ik_target_y, fk_target_q1, fk_target_q2);
+    if (set_joint_targets(ik_target_x, ik_target_y) != IK_OK) {
+      // Home is always reachable in joint space, so go there directly instead of along the ik path
+      fk_target_q1 = Q1_HOME;
+      fk_target_q2 = Q2_HOME;
+      ik_target_x = HOME_X;
+      ik_target_y = HOME_Y;
+    }
   }
-  fk_step = !step_joint_positions(fk_target_q1, fk_target_q2, MAX_JOINT_SPEED * 4, MAX_JOINT_SPEED * 4);
+  float max_speed = MAX_JOINT_SPEED * 4 * Power::speed_scale();
+  fk_step = !step_joint_positions(fk_target_q1, fk_target_q2, max_speed, max_speed);
   write_servos(q1, q2);
   check_low_power();
 }
 
 /**
  * Waits for user input. If input is momentary, then switch to descend_step. If input is held for more than ROTATE_PLATE_TIME, then switch to rotate_plate_mode.
- * If input is pressing the joystick, a momentary press will switch to descend_step. If joystick is held for more than 1 second, then switch to calibration_mode. If joystick is held for more than 10 seconds, then reset profiles.
- * @see descend_step rotate_plate_step calibration_mode reset_profiles
+ * If input is pressing the joystick, a momentary press will switch to descend_step. If joystick is held for more than 1 second, then switch to calibration_mode.
+ * If joystick is held for more than 5 seconds (LED turns back off), then switch to servo_calibration_mode. If joystick is held for more than 10 seconds, then reset profiles.
+ * Flicking the joystick left or right changes the profile bank.
+ * @see descend_step rotate_plate_step calibration_mode servo_calibration_mode reset_profiles check_profile_bank
  */
 void wait_mode() {
+  // Presses are timed across loop passes, so the profile selector and host commands keep running while a button is held
+  static UNIT_STATE bool input_was, button_was;          // Previous readings, to find the start of a press
+  static UNIT_STATE bool input_timing, button_timing;    // True while a press is being timed
+  static UNIT_STATE unsigned long input_start, button_start;  // millis() when the press started
+  if (pre) {
+    ScoopLearning::save();  // Nothing is moving, so a batch of learned offsets can be written
+    input_was = button_was = false;
+    input_timing = button_timing = false;
+  }
+  check_profile_bank();
   // Input pin is pullup, so negative logic (pressed = LOW)
-  if (digitalRead(INPUT_PIN) == LOW) {
-    int idx = check_profile_choice();
-    profile = profiles[idx];
-    timestamp = millis();
-    while (digitalRead(INPUT_PIN) == LOW && (millis() - timestamp < ROTATE_PLATE_TIME)) {}
-    timestamp = millis() - timestamp;
-    if (timestamp >= ROTATE_PLATE_TIME) {
-      switch_mode(rotate_plate_step);
-    } else if(timestamp > 50) {
-      switch_mode(descend_step);
-    }
+  bool input = digitalRead(INPUT_PIN) == LOW;
+  if (input && !input_was) {
+    input_timing = true;
+    input_start = millis();
   }
-  if (read_joystick_button()) {
-    // Wait until joystick button is released
-    timestamp = millis();
-    while ((read_joystick_button() && (millis() - timestamp < 10000)) || (millis() - timestamp < 100)) {
-      if (millis() - timestamp >= 5000) {
-        digitalWrite(WARNING_LED_PIN, LOW);
-      } else if (millis() - timestamp >= 1000) {
-        digitalWrite(WARNING_LED_PIN, HIGH);
+  input_was = input;
+  if (input_timing) {
+    unsigned long held = millis() - input_start;
+    if (held >= ROTATE_PLATE_TIME) {
+      input_timing = false;
+      switch_mode(rotate_plate_step);
+    } else if (!input) {
+      input_timing = false;
+      if (held > 50) {
+        select_profile(ProfileSelector::choice());
+        switch_mode(descend_step);
       }
     }
-    digitalWrite(WARNING_LED_PIN, LOW);
-    timestamp = millis() - timestamp;
-    if (timestamp >= 10000) {
-      reset_profiles();
-      for (int i = 0; i < 4; i++) {
-        digitalWrite(WARNING_LED_PIN, HIGH);
-        delay(125);
-        digitalWrite(WARNING_LED_PIN, LOW);
-        delay(125);
+  }
+  bool button = read_joystick_button();
+  if (button && !button_was) {
+    button_timing = true;
+    button_start = millis();
+  }
+  button_was = button;
+  if (button_timing) {
+    unsigned long held = millis() - button_start;
+    StatusLed::set(held >= 1000 && held < 5000);
+    // Decide once the button is released, after at least 100 ms so contact bounce is ignored, or once it has been held for 10 s
+    if ((!button && held >= 100) || held >= 10000) {
+      button_timing = false;
+      StatusLed::set(false);
+      if (held >= 10000) {
+        // The button is probably still down, but a new press is only started when it goes down again
+        reset_profiles();
+        for (uint8_t i = 0; i < NUM_PROFILES; i++) ScoopLearning::forget(i);
+        EventLog::log(EVENT_PROFILES_RESET, cur_mode_id, 0, Sensors::servo_voltage());
+        StatusLed::play(LED_PATTERN_QUICK, 4);
+      } else if (held >= 5000) {
+        switch_mode(servo_calibration_mode);
+      } else if (held > 1000) {
+        switch_mode(calibration_mode);
+      } else {
+        select_profile(ProfileSelector::choice());
+        switch_mode(descend_step);
       }
-      while (read_joystick_button()) {}
-    } else if (timestamp > 1000) {
-      switch_mode(calibration_mode);
-    } else {
-      int idx = check_profile_choice();
-      profile = profiles[idx];
-      switch_mode(descend_step);
     }
   }
   check_low_power();
@@ -458,16 +766,16 @@ void wait_mode() {
 
 /**
  * Lower power mode for the device, which cuts off power to the motors and blinks the led.
+ * Queued events are written to EEPROM immediately, since the device is likely to be switched off next.
  */
 void low_power_mode() {
   if (pre) {
     digitalWrite(SERVO_POWER_PWM, 0);
     DCMotor::set_speed(0);
+    EventLog::flush();
+    ScoopLearning::save(true);
+    StatusLed::play(LED_PATTERN_SLOW, 0);
   }
-  digitalWrite(WARNING_LED_PIN, HIGH);
-  delay(500);
-  digitalWrite(WARNING_LED_PIN, LOW);
-  delay(500);
 }
 
 /**
@@ -494,18 +802,23 @@ void rotate_plate_step() {
 
 /**
  * Moves end effector to the entry point of the profile. Once motion is complete, switch to scoop step.
- * @see scoop_step
+ * If the entry point cannot be reached, logs EVENT_IK_UNREACHABLE and switches to move_home_then_wait.
+ * @see scoop_step move_home_then_wait
  */
 void descend_step() {
   if (pre) {
     timestamp = millis();
-    ik_target_x = profile.entry_x;
-    ik_target_y = profile.entry_y;
-    calc_ik(ik_target_x, ik_target_y, fk_target_q1, fk_target_q2);
+    get_profile_point(profile, 0, ik_target_x, ik_target_y);
+    uint8_t ik_result = set_joint_targets(ik_target_x, ik_target_y);
+    if (ik_result != IK_OK) {
+      EventLog::log(EVENT_IK_UNREACHABLE, cur_mode_id, ik_result, Sensors::servo_voltage());
+      switch_mode(move_home_then_wait);
+      return;
+    }
 
-    balance_speed(fk_target_q1, fk_target_q2, MAX_JOINT_SPEED, q1_speed, q2_speed);
+    start_joint_move(Power::speed_scale());
   }
-  int fk_done = step_joint_positions(fk_target_q1, fk_target_q2, q1_speed, q2_speed);
+  int fk_done = step_joint_move();
   write_servos(q1, q2);
   if (fk_done) {
     switch_mode(scoop_step);
@@ -515,37 +828,77 @@ void descend_step() {
 
 /**
  * Scrapes across plate by visiting all profile points. Once motion is complete, switch to lift_step_fk.
+ * Each segment is scraped at its own speed, and the spoon backs off upwards when current exceeds the segment's contact threshold.
+ * Each segment starts at the offset it needed on previous scoops, so the floor is not probed for again on every bite.
  * If motor current measurement is greater than OVERLOAD_CURRENT, then switch to mode move_home_then_wait.
- * @see lift_step_fk move_home_then_wait
+ * If a point of the profile cannot be reached, logs EVENT_IK_UNREACHABLE and switches to return_step.
+ * @see lift_step_fk move_home_then_wait return_step ScoopLearning
  */
 void scoop_step() {
-  static float y_off;
+  static UNIT_STATE float y_off;
+  static UNIT_STATE float end_x, end_y;
+  static UNIT_STATE size_t reached_step;  // Furthest ik_step of this scoop, so backing off does not restart a segment's offset
+  static UNIT_STATE bool contact;         // True if the spoon backed off during the furthest segment
   if (pre) {
-    y_off = 0; // y offset
-    ik_step = 1; // which profile point to go towards (1-3)
+    y_off = max(ScoopLearning::offset(0), 0.0); // y offset
+    ik_step = 1; // which profile point to go towards
     fk_step = 0; // 0 if fk move is done
+    reached_step = 1;
+    contact = false;
+    q1_speed = MAX_JOINT_SPEED;  // Each joint follows the ik steps at up to the step speed, also through cancel_scoop_*_step
+    q2_speed = MAX_JOINT_SPEED;
     timestamp = millis();
+    get_profile_point(profile, profile.num_points - 1, end_x, end_y);
+    ScoopLearning::discard();
   }
   if (fk_step == 0) {
     float x_dest = 0, y_dest = 0;
     bool profile_success = get_profile_step(profile, ik_step, x_dest, y_dest);
     if (profile_success) {
-      int current = analogRead(0);
-      digitalWrite(WARNING_LED_PIN, current > THRESHOLD_CURRENT);
+      // The segment being scraped ends at the point of ik_step, and sets its own speed and contact threshold
+      int threshold = get_segment_force(profile, ik_step - 1, THRESHOLD_CURRENT);
+      int current = Sensors::servo_current();
+      StatusLed::set(current > threshold);
       int ik_done = 0;
-      if (current > OVERLOAD_CURRENT) switch_mode(move_home_then_wait);
-      else if (current > THRESHOLD_CURRENT) {
+      if (current > OVERLOAD_CURRENT) {
+        EventLog::log(EVENT_SCOOP_OVERLOAD, cur_mode_id, current, Sensors::servo_voltage());
+        // move_home_then_wait steps from the ik target, so the offset is folded into it. Otherwise the spoon would first drive
+        // back down by y_off into whatever stalled it.
+        ik_target_y = min(ik_target_y + y_off, end_y);
+        constrain_ik_point(ik_target_x, ik_target_y);
+        y_off = 0;
+        switch_mode(move_home_then_wait);
+      }
+      else if (current > threshold) {
         y_off += 4*IK_STEP_SIZE;
+        contact = true;
         ik_step = max(1, ik_step-1);
       }
-      else ik_done = step_ik_target(x_dest, y_dest, IK_STEP_SIZE);
+      else ik_done = step_ik_target(x_dest, y_dest, IK_STEP_SIZE * get_segment_speed(profile, ik_step - 1) * Power::speed_scale());
       
       if (ik_done) {
+        if (ik_step == reached_step) ScoopLearning::observe(ik_step - 1, y_off, contact);
         ik_step += 1;
+        if (ik_step > reached_step) {
+          // Entering a new segment: start at its learned offset, or keep the current one until it is learned
+          reached_step = ik_step;
+          contact = false;
+          float learned = ScoopLearning::offset(ik_step - 1);
+          if (learned >= 0) y_off = learned;
+        }
+      }
+      // Lifting a point that lies on a reach limit can take it out of reach, so the lifted point is constrained again
+      float lifted_x = ik_target_x, lifted_y = min(ik_target_y+y_off, end_y);
+      constrain_ik_point(lifted_x, lifted_y);
+      uint8_t ik_result = set_joint_targets(lifted_x, lifted_y);
+      if (ik_result != IK_OK) {
+        EventLog::log(EVENT_IK_UNREACHABLE, cur_mode_id, ik_result, Sensors::servo_voltage());
+        ScoopLearning::discard();
+        switch_mode(return_step);
       }
-      bool ik_success = calc_ik(ik_target_x, min(ik_target_y+y_off, profile.end_y), fk_target_q1, fk_target_q2);
     } else {
       // We are done stepping through the profile, go to next mode
+      ScoopLearning::finish();
       switch_mode(lift_step_fk);
     }
   }
@@ -560,7 +913,9 @@ void scoop_step() {
 }
 
 /**
- * Lifts spoon up to user with forward kinematics (sets joint states directly).
+ * Lifts spoon up to user along a straight line, to the arm straight out (q1 = q2 = 0).
+ * The line is timed so the spoon tilts no faster than LINE_MAX_TURN_RATE, and its acceleration and jerk stay within the
+ * profile's carry limits, which keeps food on it.
  * When destination is reached, switches to feed_wait_step.
  * If measured current for the servos exceeds OVERLOAD_CURRENT, then switch to return_step.
  * @see feed_wait_step return_step
@@ -569,16 +924,16 @@ void lift_step_fk() {
   if (pre) {
     fk_target_q1 = 0.0;
     fk_target_q2 = 0.0;
-    ik_target_x = L1 + L2;
-    ik_target_y = 0.0;
-    balance_speed(fk_target_q1, fk_target_q2, MAX_JOINT_SPEED * 0.75, q1_speed, q2_speed);
+    start_line_move(L1 + L2, 0.0, Power::speed_scale(),
+                    get_carry_accel(profile, LINE_CARRY_ACCEL), get_carry_jerk(profile, LINE_CARRY_JERK));
   }
-  int current = analogRead(0);
+  int current = Sensors::servo_current();
   if (current > OVERLOAD_CURRENT) {
+    EventLog::log(EVENT_LIFT_OVERLOAD, cur_mode_id, current, Sensors::servo_voltage());
     switch_mode(return_step);
   }
 
-  bool fk_done = step_joint_positions(fk_target_q1, fk_target_q2, q1_speed, q2_speed);
+  bool fk_done = step_line_move();
   write_servos(q1, q2);
   if (fk_done) {
     switch_mode(feed_wait_step);
@@ -587,36 +942,44 @@ void lift_step_fk() {
 
 /**
  * Waits for user to eat the food. Switches to return step on user input.
- * @see return_step
+ * When LOOP_STATS is enabled, holding the input for LOOP_STATS_DUMP_TIME instead dumps loop statistics and keeps waiting.
+ * @see return_step LoopStats::dump
  */
 void feed_wait_step() {
-  if (digitalRead(INPUT_PIN) == LOW || read_joystick_button()) {
-    while (digitalRead(INPUT_PIN) == LOW || read_joystick_button()) {}
+  static UNIT_STATE bool pressed = false;
+  static UNIT_STATE unsigned long press_start;  // millis() when the press started
+  if (pre) {
+    pressed = false;
+  }
+  bool down = digitalRead(INPUT_PIN) == LOW || read_joystick_button();
+  if (down && !pressed) {
+    pressed = true;
+    press_start = millis();
+  } else if (!down && pressed) {
+    // Released: the press is timed across loop passes instead of waiting here, so the loop keeps running while it is held
+    pressed = false;
+    if (LOOP_STATS && millis() - press_start >= LOOP_STATS_DUMP_TIME) {
+      LoopStats::dump();
+      return;
+    }
     switch_mode(return_step);
   }
 }
 
 /**
- * Moves arm back to starting position, then switches to wait mode.
- * If the starting position is invalid, then resets profiles. This allows loading profiles on first boot or fixing EEPROM corruption.
- * @see wait_mode
+ * Moves the spoon along a straight line to above the end of the profile, then switches to move_home_then_wait.
+ * @see move_home_then_wait
  */
 void return_step() {
   if (pre) {
-    ik_target_x = profile.end_x;
-    ik_target_y = profile.end_y + 30.0; // Make sure to clear the bowl/plate
-    if (constrain_ik_point(ik_target_x, ik_target_y)) {
-      reset_profiles();
-      profile = profiles[check_profile_choice()];
-      switch_mode(lift_step_fk);
-      digitalWrite(WARNING_LED_PIN, HIGH);
-      delay(25);
-      digitalWrite(WARNING_LED_PIN, LOW);
-    }
-    calc_ik(ik_target_x, ik_target_y, fk_target_q1, fk_target_q2);
-    balance_speed(fk_target_q1, fk_target_q2, MAX_JOINT_SPEED, q1_speed, q2_speed);
+    float x, y;
+    get_profile_point(profile, profile.num_points - 1, x, y);
+    y += 30.0; // Make sure to clear the bowl/plate
+    constrain_ik_point(x, y);
+    set_joint_targets(x, y);  // Holds if out of reach, and move_home_then_wait takes over
+    start_line_move(x, y, Power::speed_scale(), LINE_MAX_ACCEL, 0);  // The spoon is empty
   }
-  bool fk_done = step_joint_positions(fk_target_q1, fk_target_q2, q1_speed, q2_speed);
+  bool fk_done = step_line_move();
   write_servos(q1, q2);
   
   if (fk_done) {
@@ -631,7 +994,7 @@ void return_step() {
  */
 void cancel_scoop_up_step() {
   if (pre) {
-    ik_step = 4;
+    ik_step = profile.num_points - 1;  // The exit step, above the end point
     fk_step = 0;
     timestamp = millis();
   }
@@ -643,7 +1006,7 @@ void cancel_scoop_up_step() {
       if (ik_done) {
         ik_step += 1;
       }
-      bool ik_success = calc_ik(ik_target_x, ik_target_y, fk_target_q1, fk_target_q2);
+      if (set_joint_targets(ik_target_x, ik_target_y) != IK_OK) switch_mode(return_step);
     } else {
       // We are done stepping through the profile, go to next mode
       switch_mode(cancel_scoop_out_step);
@@ -660,7 +1023,7 @@ void cancel_scoop_up_step() {
  */
 void cancel_scoop_out_step() {
   if (pre) {
-    ik_step = 4;
+    ik_step = profile.num_points - 1;  // The exit step, above the end point
     fk_step = 0;
     timestamp = millis();
   }
@@ -672,7 +1035,7 @@ void cancel_scoop_out_step() {
       if (ik_done) {
         ik_step += 1;
       }
-      bool ik_success = calc_ik(ik_target_x, ik_target_y, fk_target_q1, fk_target_q2);
+      if (set_joint_targets(ik_target_x, ik_target_y) != IK_OK) switch_mode(return_step);
     } else {
       // We are done stepping through the profile, go to next mode
       switch_mode(lift_step_fk);
@@ -701,79 +1064,208 @@ static void head_nod() {
 
 /**
  * Calibration mode for the device, allows users to set keypoints for differently shaped plates and bowls.
- * Click the joystick button to set a profile point, or hold the joystick button down to cancel calibration.
- * @see constrain_ik_point save_profile
+ * The joystick moves the spoon at a speed proportional to its deflection, up to JOG_MAX_SPEED, with small deflections kept slow for fine positioning.
+ * Click the joystick button to add a profile point, or hold the joystick button down to cancel calibration.
+ * Press the input switch to set the end point and save. The profile is also saved once MAX_PROFILE_POINTS points are set.
+ * Segment speeds and contact thresholds are kept from the previous version of the profile.
+ * The new points are written into the active profile in place, and the edits are discarded if calibration is cancelled.
+ * @see constrain_ik_point save_profile edit_active_profile
  */
 void calibration_mode() {
-  static uint8_t calibration_step = 0;
-  static uint8_t profile_index = 0;
-  static Profile profile_to_change;
+  static UNIT_STATE uint8_t calibration_step = 0;
+  static UNIT_STATE uint8_t profile_index = 0;
   if (pre) {
     calibration_step = 0;
     fk_step = 0;
     q1_speed = MAX_JOINT_SPEED;
     q2_speed = MAX_JOINT_SPEED;
     timestamp = millis();
-    profile_index = check_profile_choice();
+    profile_index = ProfileSelector::choice();
     if (profile_index < 0 || profile_index > (NUM_PROFILES-1)) {
       switch_mode(move_home_then_wait);
       return;
     }
-    profile_to_change = profiles[profile_index];
+    select_profile(profile_index);
     DCMotor::set_speed(DC_MOTOR_SPEED);
+    start_joystick_jog();
   }
-  constexpr float speed = 0.05;
-  const float max_mag = L1 + L2;
-  int joy_x = read_joystick_x();
-  int joy_y = read_joystick_y();
-  ik_target_x += speed * joy_x;
-  ik_target_y += speed * joy_y;
+  Profile &profile_to_change = edit_active_profile();
+  joystick_jog(ik_target_x, ik_target_y, JOG_MAX_SPEED, JOG_MAX_ACCEL);
   // Prevent ik target from going out of absolute workspace bounds
   constrain_ik_point(ik_target_x, ik_target_y);
 
   if (fk_step == 0) {
-    int ik_done = step_ik_target(ik_target_x, ik_target_y, IK_STEP_SIZE);
-    bool ik_success = calc_ik(ik_target_x, ik_target_y, q1, q2);
+    if (solve_ik(ik_target_x, ik_target_y, q1, q2, q1, q2) != IK_OK) {
+      calc_fk(q1, q2, ik_target_x, ik_target_y);  // Stay where the arm is instead of pushing into a joint limit
+    }
   }
   write_servos(q1, q2);
 
+  // The input switch ends the profile, but only once there is an entry point before it
+  bool set_end = calibration_step >= MIN_PROFILE_POINTS - 1 && digitalRead(INPUT_PIN) == LOW;
+  if (set_end) {
+    while (digitalRead(INPUT_PIN) == LOW) {}
+  }
   if (millis() - timestamp > 500 && read_joystick_button()) {
     unsigned long push_time = millis();
     while (read_joystick_button() && (millis() - push_time) <= 1000) {}
     if (millis() - push_time > 1000) { // Cancel the calibration
+      activate_profile(profile_index);  // Discard the new points
       DCMotor::set_speed(0);
       switch_mode(move_home_then_wait);
       while (read_joystick_button()) {}
       return;
     }
-    switch (calibration_step) {
-      case 0:  // Set entry
-        profile_to_change.entry_x = ik_target_x;
-        profile_to_change.entry_y = ik_target_y;
-        break;
-      case 1:  // Set bottom edge
-        profile_to_change.bottom_x = ik_target_x;
-        profile_to_change.bottom_y = ik_target_y;
-        break;
-      case 2:  // Set middle
-        profile_to_change.middle_x = ik_target_x;
-        profile_to_change.middle_y = ik_target_y;
-        break;
-      case 3:  // Set bottom front
-        profile_to_change.front_x = ik_target_x;
-        profile_to_change.front_y = ik_target_y;
-        break;
-      default:  // Set end, save, and return to home
-        profile_to_change.end_x = ik_target_x;
-        profile_to_change.end_y = ik_target_y;
-        save_profile(profile_to_change, profile_index);
-        profiles[profile_index] = profile_to_change;
-        DCMotor::set_speed(0);
-        switch_mode(move_home_then_wait);
-        break;
+    set_end = calibration_step >= MAX_PROFILE_POINTS - 1;
+    if (!set_end) {
+      set_profile_point(profile_to_change, calibration_step, ik_target_x, ik_target_y);
+      calibration_step += 1;
+      head_nod();
     }
-    calibration_step += 1;
+  }
+  if (set_end) {  // Set end, save, and return to home
+    set_profile_point(profile_to_change, calibration_step, ik_target_x, ik_target_y);
+    profile_to_change.num_points = calibration_step + 1;
+    save_profile(profile_to_change, profile_index);
+    ScoopLearning::forget(profile_index);
+    DCMotor::set_speed(0);
+    switch_mode(move_home_then_wait);
     head_nod();
   }
   check_low_power();
 }
+
+/**
+ * Servo calibration mode, builds the angle to pulse width table of each servo so that misaligned or nonlinear servos can be corrected without reflashing.
+ * Each servo is taken through SERVO_CAL_POINTS angles, evenly spaced from -90 to 90 degrees in the servo's frame, starting with servo 1.
+ * While one servo is calibrated, the other is held at its center point (q1 = -PI/2 or q2 = PI/2).
+ * Move the joystick up or down until the arm matches the angle on the alignment jig, then click the joystick button to store the point.
+ * After the last point of servo 2 the tables are saved. Hold the joystick button down to cancel without saving.
+ * @see ServoCalibration
+ */
+void servo_calibration_mode() {
+  static UNIT_STATE uint8_t cal_servo = 0;
+  static UNIT_STATE uint8_t cal_point = 0;
+  static UNIT_STATE uint16_t pw = 0;  // Kept within what ServoDriver sends, so each point stores the pulse the servo was aligned with
+  if (pre) {
+    cal_servo = 0;
+    cal_point = 0;
+    pw = constrain(ServoCalibration::get_point(cal_servo, cal_point), SERVO_MIN_PULSE_TICKS, SERVO_MAX_PULSE_TICKS);
+    timestamp = millis();
+  }
+  // Nominal joint angle of the current point, and of the center point for the servo that is held still
+  const float angle = -PI * 0.5 + cal_point * PI / (SERVO_CAL_POINTS - 1);
+  if (cal_servo == 0) {
+    q1 = -angle - PI * 0.5;
+    q2 = PI * 0.5;
+    ServoDriver::write(pw, ServoCalibration::pulse_width(1, SERVO_CAL_RANGE / 2));
+  } else {
+    q1 = -PI * 0.5;
+    q2 = PI * 0.5 - angle;
+    ServoDriver::write(ServoCalibration::pulse_width(0, SERVO_CAL_RANGE / 2), pw);
+  }
+
+  if (millis() - timestamp >= SERVO_CAL_ADJUST_INTERVAL) {
+    timestamp = millis();
+    pw = constrain((int)pw + read_joystick_y(), SERVO_MIN_PULSE_TICKS, SERVO_MAX_PULSE_TICKS);
+  }
+
+  if (read_joystick_button()) {
+    unsigned long push_time = millis();
+    while (read_joystick_button() && (millis() - push_time) <= 1000) {}
+    if (millis() - push_time > 1000) {  // Cancel the calibration, and go back to the saved tables
+      ServoCalibration::load();
+      write_servos(q1, q2);
+      switch_mode(move_home_then_wait);
+      while (read_joystick_button()) {}
+      return;
+    }
+    ServoCalibration::set_point(cal_servo, cal_point, pw);
+    StatusLed::play(LED_PATTERN_POINT, 1);
+    cal_point += 1;
+    if (cal_point >= SERVO_CAL_POINTS) {
+      cal_point = 0;
+      cal_servo += 1;
+    }
+    if (cal_servo > 1) {
+      // A table that is not increasing cannot be saved, so keep the old one
+      if (!ServoCalibration::save()) {
+        ServoCalibration::load();
+      }
+      write_servos(q1, q2);
+      switch_mode(move_home_then_wait);
+      return;
+    }
+    pw = constrain(ServoCalibration::get_point(cal_servo, cal_point), SERVO_MIN_PULSE_TICKS, SERVO_MAX_PULSE_TICKS);
+  }
+  check_low_power();
+}
+
+/**
+ * Holds the arm still at home while the host writes profiles or calibration data, so EEPROM writes never stall a motion.
+ * Entered and left with host commands. Switches back to wait_mode if the host goes quiet for HOST_MODE_TIMEOUT.
+ * @see check_host_commands
+ */
+void host_mode() {
+  if (pre) {
+    host_command_time = millis();
+  }
+  if (millis() - host_command_time > HOST_MODE_TIMEOUT) {
+    select_profile(ProfileSelector::choice());
+    switch_mode(wait_mode);
+  }
+  check_low_power();
+}
+
+/**
+ * Follows timestamped setpoints streamed by the host. Each setpoint is reached by interpolating the joints linearly over its dt_ms,
+ * limited to Q1_MAX_SPEED and Q2_MAX_SPEED over elapsed time, like planned joint moves. Segments start where the previous one was due, so timing does not drift.
+ * When the buffer runs empty the arm holds its position, and the next setpoint starts from there.
+ * Returns home on FRAME_CMD_END, on overload, or if the host goes quiet for HOST_MODE_TIMEOUT.
+ * @see check_host_commands MotionStream
+ */
+void stream_mode() {
+  if (pre) {
+    stream_moving = false;
+    host_command_time = millis();
+  }
+  unsigned long now = millis();
+  if (!stream_moving || now - stream_start >= stream_target.dt_ms) {
+    if (stream_moving) stream_start += stream_target.dt_ms;
+    if (MotionStream::pop(stream_target)) {
+      if (!stream_moving) {
+        stream_start = now;
+        stream_step_time = micros();
+      }
+      stream_from_q1 = q1;
+      stream_from_q2 = q2;
+      stream_moving = true;
+    } else if (stream_moving) {
+      stream_moving = false;
+      MotionStream::underrun();
+    }
+  }
+  if (stream_moving) {
+    float f = stream_target.dt_ms == 0 ? 1.0 : min(1.0, (now - stream_start) / (float)stream_target.dt_ms);
+    float target_q1 = stream_from_q1 + (stream_target.a * 0.001 - stream_from_q1) * f;
+    float target_q2 = stream_from_q2 + (stream_target.b * 0.001 - stream_from_q2) * f;
+    // The joint speed limits apply over the time since the previous step, so they do not depend on the loop rate
+    unsigned long now_us = micros();
+    float dt = min(now_us - stream_step_time, (unsigned long)STREAM_MAX_STEP_TIME) * 1e-6;
+    stream_step_time = now_us;
+    step_joint_positions(target_q1, target_q2, Q1_MAX_SPEED * dt, Q2_MAX_SPEED * dt);
+    write_servos(q1, q2);
+    calc_fk(q1, q2, ik_target_x, ik_target_y);  // move_home_then_wait starts from the IK target
+  }
+  int current = Sensors::servo_current();
+  if (current > OVERLOAD_CURRENT) {
+    EventLog::log(EVENT_STREAM_OVERLOAD, cur_mode_id, current, Sensors::servo_voltage());
+    MotionStream::clear();
+    switch_mode(move_home_then_wait);
+  }
+  if (millis() - host_command_time > HOST_MODE_TIMEOUT) {
+    MotionStream::clear();
+    switch_mode(move_home_then_wait);
+  }
+  check_low_power();
+}
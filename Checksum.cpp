@@ -0,0 +1,10 @@
+#include "Checksum.h"
+#include <util/crc16.h>
+
+uint8_t crc8(const void *data, size_t len, uint8_t crc) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    crc = _crc8_ccitt_update(crc, bytes[i]);
+  }
+  return crc;
+}
@@ -0,0 +1,15 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Calculates the CRC-8 (polynomial 0x07) of a block of memory.
+ * @param data Start of the block
+ * @param len Number of bytes
+ * @param crc Starting value, pass a previous result to continue a CRC across several blocks.
+ * @return The CRC of the block
+ */
+uint8_t crc8(const void *data, size_t len, uint8_t crc = 0);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef EEPROMMAP_H
+#define EEPROMMAP_H
+
+// Start address and length in bytes of each region of the 1 KB EEPROM.
+// Regions must not overlap. Moving a region loses the data stored in it.
+
+#define EEPROM_PROFILE_START 0
+#define EEPROM_PROFILE_LEN 720
+
+#define EEPROM_EVENT_LOG_START 720
+#define EEPROM_EVENT_LOG_LEN 152
+
+#define EEPROM_SCOOP_LEARN_START 872
+#define EEPROM_SCOOP_LEARN_LEN 120
+
+#define EEPROM_SERVO_CAL_START 992
+#define EEPROM_SERVO_CAL_LEN 32
+
+#endif
@@ -0,0 +1,105 @@
+#include "EventLog.h"
+#include "UnitState.h"
+#include "EEPROMMap.h"
+#include "Checksum.h"
+#include "SerialLink.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/eeprom.h>
+
+// EEPROM layout: [boot count][entry 0][entry 1]...[entry EVENT_LOG_ENTRIES-1]
+#define BOOT_ADDR EEPROM_EVENT_LOG_START
+#define ENTRY_ADDR(i) (EEPROM_EVENT_LOG_START + 1 + sizeof(EventRecord) * (i))
+
+static_assert(1 + sizeof(EventRecord) * EVENT_LOG_ENTRIES <= EEPROM_EVENT_LOG_LEN, "Event log does not fit its EEPROM region");
+
+namespace EventLog {
+
+static UNIT_STATE uint8_t boot = 0;
+static UNIT_STATE uint8_t next_entry = 0;  // Entry the next event is written to
+static UNIT_STATE uint8_t next_seq = 0;
+// Events waiting to be written. queue[0] is being written, starting from byte write_pos.
+static UNIT_STATE EventRecord queue[EVENT_LOG_QUEUE];
+static UNIT_STATE uint8_t queued = 0;
+static UNIT_STATE uint8_t write_pos = 0;
+
+static bool read_entry(uint8_t idx, EventRecord &rec) {
+  EEPROM.get(ENTRY_ADDR(idx), rec);
+  return rec.crc == crc8(&rec, offsetof(EventRecord, crc));
+}
+
+void begin() {
+  // The newest entry is the last valid one in a run of consecutive sequence numbers
+  EventRecord cur, next;
+  bool cur_ok = read_entry(0, cur);
+  for (uint8_t i = 0; i < EVENT_LOG_ENTRIES; i++) {
+    uint8_t n = (i + 1) % EVENT_LOG_ENTRIES;
+    bool next_ok = read_entry(n, next);
+    if (cur_ok && (!next_ok || next.seq != (uint8_t)(cur.seq + 1))) {
+      next_entry = n;
+      next_seq = cur.seq + 1;
+      break;
+    }
+    cur = next;
+    cur_ok = next_ok;
+  }
+  boot = EEPROM.read(BOOT_ADDR) + 1;
+  EEPROM.write(BOOT_ADDR, boot);
+}
+
+void log(uint8_t type, uint8_t mode, uint16_t current, uint16_t voltage) {
+  if (queued >= EVENT_LOG_QUEUE) { return; }
+  EventRecord &rec = queue[queued];
+  rec.seq = next_seq++;
+  rec.boot = boot;
+  rec.type = type;
+  rec.mode = mode;
+  rec.time_s = millis() / 1000;
+  rec.current = min(current / 4, 255);
+  rec.voltage = min(voltage / 4, 255);
+  rec.crc = crc8(&rec, offsetof(EventRecord, crc));
+  queued++;
+}
+
+void service() {
+  if (queued == 0 || !eeprom_is_ready()) { return; }
+  EEPROM.update(ENTRY_ADDR(next_entry) + write_pos, ((const uint8_t *)&queue[0])[write_pos]);
+  write_pos++;
+  if (write_pos < sizeof(EventRecord)) { return; }
+  // Entry complete, move on to the next one
+  write_pos = 0;
+  next_entry = (next_entry + 1) % EVENT_LOG_ENTRIES;
+  queued--;
+  memmove(queue, queue + 1, sizeof(EventRecord) * queued);
+}
+
+void flush() {
+  while (queued > 0) {
+    eeprom_busy_wait();
+    service();
+  }
+}
+
+void dump() {
+  flush();
+  EventRecord rec;
+  for (uint8_t i = 0; i < EVENT_LOG_ENTRIES; i++) {
+    // next_entry holds the oldest entry once the log has wrapped around
+    if (read_entry((next_entry + i) % EVENT_LOG_ENTRIES, rec)) {
+      SerialLink::send_wait(FRAME_EVENT, &rec, sizeof(rec));
+    }
+  }
+}
+
+void clear() {
+  flush();
+  EventRecord rec;
+  for (uint8_t i = 0; i < EVENT_LOG_ENTRIES; i++) {
+    // Changing any byte of a valid entry breaks its CRC
+    if (read_entry(i, rec)) {
+      EEPROM.update(ENTRY_ADDR(i), rec.seq ^ 0xFF);
+    }
+  }
+}
+
+};
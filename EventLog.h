@@ -0,0 +1,72 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+#include <stdint.h>
+
+#define EVENT_LOG_ENTRIES 16 /** Events kept in EEPROM, the oldest is overwritten first */
+#define EVENT_LOG_QUEUE 4 /** Events that can wait in RAM to be written */
+
+// Event types
+#define EVENT_SCOOP_OVERLOAD 1 /** Scooping was aborted because servo current exceeded OVERLOAD_CURRENT */
+#define EVENT_LIFT_OVERLOAD 2 /** Lifting was aborted because servo current exceeded OVERLOAD_CURRENT */
+#define EVENT_LOW_POWER 3 /** Servo voltage dropped below the low power limit */
+#define EVENT_PROFILES_REPAIRED 4 /** Profiles were missing or corrupted at boot and were replaced with defaults */
+#define EVENT_PROFILES_RESET 5 /** Profiles were reset to defaults by the user */
+#define EVENT_STREAM_OVERLOAD 6 /** A streamed motion was stopped because servo current exceeded OVERLOAD_CURRENT */
+#define EVENT_IK_UNREACHABLE 7 /** A profile point had no IK solution within the servo ranges. The current field holds the IK_* result */
+
+/**
+ * An entry of the event log, and the payload of a FRAME_EVENT frame. tools/event_log.py must be updated if this changes.
+ */
+typedef struct EventRecord {
+  uint8_t seq;      // Increases by one with each event, used to find the newest entry
+  uint8_t boot;     // Boot count when the event happened
+  uint8_t type;     // EVENT_*
+  uint8_t mode;     // Id of the mode that was running
+  uint16_t time_s;  // Seconds since boot
+  uint8_t current;  // Servo current sense / 4, in analogRead units
+  uint8_t voltage;  // Servo voltage sense / 4, in analogRead units
+  uint8_t crc;      // CRC of all previous fields
+} EventRecord;
+
+/**
+ * Append-only circular log of faults and events in EEPROM, kept across power cycles.
+ * Events are queued in RAM and written one byte at a time whenever the EEPROM is idle, so logging never waits on EEPROM writes.
+ */
+namespace EventLog {
+  /**
+   * @brief Finds the newest entry and counts this boot. Call once at startup.
+   */
+  void begin();
+
+  /**
+   * @brief Queues an event. If the queue is full the event is dropped.
+   * @param type EVENT_* type
+   * @param mode Id of the running mode
+   * @param current Servo current sense in analogRead units
+   * @param voltage Servo voltage sense in analogRead units
+   */
+  void log(uint8_t type, uint8_t mode, uint16_t current, uint16_t voltage);
+
+  /**
+   * @brief Writes the next queued byte if the EEPROM is idle. Never waits. Call once per loop.
+   */
+  void service();
+
+  /**
+   * @brief Writes all queued events, waiting for the EEPROM. Only call when nothing is moving.
+   */
+  void flush();
+
+  /**
+   * @brief Sends every valid entry as a FRAME_EVENT frame, oldest first. Writes queued events first, and blocks until all frames
+   * are queued, so only call when nothing is moving.
+   */
+  void dump();
+
+  /**
+   * @brief Erases every entry. Waits for the EEPROM, so only call when nothing is moving.
+   */
+  void clear();
+};
+
+#endif
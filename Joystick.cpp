@@ -1,4 +1,5 @@
 #include "Joystick.h"
+#include "UnitState.h"
 #include <Arduino.h>
 
 // Change these values to tune for your specific joystick
@@ -7,6 +8,18 @@
 // X is inverted because of the orientation of the joystick
 #define X_SIGN (-1)
 #define Y_SIGN 1
+// Proportional reading
+#define JOY_CAL_SAMPLES 16 /** Readings averaged for each center */
+#define JOY_MIN_DEADZONE 24 /** Deadzone of the proportional reading, before adding noise seen during calibration. Covers the spring's return error. */
+#define JOY_MAX_READING 1023
+#define JOY_EXPO 0.7 /** 0 is linear, 1 is fully cubic */
+#define JOG_MAX_STEP_TIME 50000 /** Longest time in microseconds a single jog step integrates, so a blocking wait does not cause a jump */
+
+static UNIT_STATE uint16_t x_deadzone = JOY_MIN_DEADZONE;
+static UNIT_STATE uint16_t y_deadzone = JOY_MIN_DEADZONE;
+static UNIT_STATE float jog_vx = 0;  // Jog velocity in mm/s
+static UNIT_STATE float jog_vy = 0;
+static UNIT_STATE unsigned long jog_time = 0;  // micros() of the previous jog step
 
 int read_joystick_x() {
   int val = X_SIGN*(analogRead(JOY_X_PIN)-X_CENTER);
@@ -32,4 +45,60 @@ int read_joystick_y() {
 
 int read_joystick_button() {
   return digitalRead(JOYSTICK_BUTTON_PIN) == LOW;
-}
\ No newline at end of file
+}
+
+static uint16_t calibrate_axis(uint8_t pin, uint16_t &deadzone) {
+  uint32_t sum = 0;
+  uint16_t lo = JOY_MAX_READING, hi = 0;
+  for (uint8_t i = 0; i < JOY_CAL_SAMPLES; i++) {
+    uint16_t val = analogRead(pin);
+    sum += val;
+    lo = min(lo, val);
+    hi = max(hi, val);
+  }
+  deadzone = JOY_MIN_DEADZONE + 2 * (hi - lo);
+  return (sum + JOY_CAL_SAMPLES / 2) / JOY_CAL_SAMPLES;
+}
+
+void calibrate_joystick() {
+  X_CENTER = calibrate_axis(JOY_X_PIN, x_deadzone);
+  Y_CENTER = calibrate_axis(JOY_Y_PIN, y_deadzone);
+}
+
+static float read_axis(uint8_t pin, uint16_t center, uint16_t deadzone) {
+  int val = analogRead(pin) - center;
+  // The center is rarely at mid scale, so each side has its own travel
+  int travel = (val < 0 ? center : JOY_MAX_READING - center) - deadzone;
+  int beyond = abs(val) - deadzone;
+  if (beyond <= 0 || travel <= 0) {
+    return 0;
+  }
+  float mag = min((float)beyond / travel, 1.0);
+  mag = (1 - JOY_EXPO) * mag + JOY_EXPO * mag * mag * mag;
+  return val < 0 ? -mag : mag;
+}
+
+float read_joystick_x_prop() {
+  return X_SIGN * read_axis(JOY_X_PIN, X_CENTER, x_deadzone);
+}
+
+float read_joystick_y_prop() {
+  return Y_SIGN * read_axis(JOY_Y_PIN, Y_CENTER, y_deadzone);
+}
+
+void start_joystick_jog() {
+  jog_vx = 0;
+  jog_vy = 0;
+  jog_time = micros();
+}
+
+void joystick_jog(float &x, float &y, float max_speed, float max_accel) {
+  unsigned long now = micros();
+  float dt = min(now - jog_time, (unsigned long)JOG_MAX_STEP_TIME) * 1e-6;
+  jog_time = now;
+  float dv = max_accel * dt;
+  jog_vx += constrain(max_speed * read_joystick_x_prop() - jog_vx, -dv, dv);
+  jog_vy += constrain(max_speed * read_joystick_y_prop() - jog_vy, -dv, dv);
+  x += jog_vx * dt;
+  y += jog_vy * dt;
+}
@@ -1,12 +1,13 @@
 #ifndef JOYSTICK_H
 #define JOYSTICK_H
 #include <stdint.h>
+#include "UnitState.h"
 
 #define JOY_X_PIN 2
 #define JOY_Y_PIN 3
 #define JOYSTICK_BUTTON_PIN 7
 
-extern uint16_t X_CENTER, Y_CENTER;
+extern UNIT_STATE uint16_t X_CENTER, Y_CENTER;
 
 /**
  * @brief Returns -1 if left of center, 1 if right of center, 0 if at center.
@@ -23,4 +24,37 @@ int read_joystick_y();
  */
 int read_joystick_button();
 
+/**
+ * @brief Sets X_CENTER and Y_CENTER to the average of several readings, and sizes each deadzone from the noise seen
+ * while sampling. The joystick must be left at rest. Call once at startup, after the servos are powered.
+ */
+void calibrate_joystick();
+
+/**
+ * @brief Returns the deflection right of center as a proportion from -1 to 1, 0 inside the calibrated deadzone.
+ * The deadzone is subtracted so the output rises from 0 at its edge, and each side is scaled to its own travel.
+ * An expo curve keeps small deflections fine and large deflections fast.
+ */
+float read_joystick_x_prop();
+
+/**
+ * @brief Returns the deflection above center as a proportion from -1 to 1, shaped like read_joystick_x_prop.
+ */
+float read_joystick_y_prop();
+
+/**
+ * @brief Starts a jog from rest. Call when a mode starts jogging, so time spent in other modes is not counted.
+ */
+void start_joystick_jog();
+
+/**
+ * @brief Moves a point by the joystick velocity over the time since the previous call.
+ * Full deflection moves at max_speed, and the velocity changes by at most max_accel, so the result does not depend on the loop rate.
+ * @param x x coordinate to move, in mm
+ * @param y y coordinate to move, in mm
+ * @param max_speed Speed at full deflection, in mm/s
+ * @param max_accel Largest change of velocity, in mm/s^2
+ */
+void joystick_jog(float &x, float &y, float max_speed, float max_accel);
+
 #endif
\ No newline at end of file
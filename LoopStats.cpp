@@ -0,0 +1,67 @@
+#include "LoopStats.h"
+#include "UnitState.h"
+
+#if LOOP_STATS
+#include "SerialLink.h"
+#include <Arduino.h>
+
+namespace LoopStats {
+
+typedef struct ModeStats {
+  uint16_t min_us;
+  uint16_t max_us;
+  uint32_t sum_us;
+  uint16_t count;
+  uint8_t buckets[LOOP_STATS_BUCKETS];
+} ModeStats;
+
+static UNIT_STATE ModeStats stats[LOOP_STATS_MAX_MODES];
+
+/**
+ * Halves the histogram and the mean's sample count together, so the mean and bucket proportions are kept without overflowing.
+ */
+static void decay(ModeStats &m) {
+  for (uint8_t i = 0; i < LOOP_STATS_BUCKETS; i++) {
+    m.buckets[i] >>= 1;
+  }
+  m.sum_us >>= 1;
+  m.count >>= 1;
+}
+
+void record(uint8_t mode, uint16_t us) {
+  if (mode >= LOOP_STATS_MAX_MODES) { return; }
+  ModeStats &m = stats[mode];
+  if (m.count == 0 || us < m.min_us) m.min_us = us;
+  if (us > m.max_us) m.max_us = us;
+  uint8_t b = 0;
+  for (uint16_t v = us >> 7; v != 0 && b < LOOP_STATS_BUCKETS - 1; v >>= 1) {
+    b++;
+  }
+  if (m.buckets[b] == 0xFF || m.count == 0xFFFF) decay(m);
+  m.buckets[b]++;
+  m.sum_us += us;
+  m.count++;
+}
+
+void reset() {
+  memset(stats, 0, sizeof(stats));
+}
+
+void dump() {
+  for (uint8_t i = 0; i < LOOP_STATS_MAX_MODES; i++) {
+    const ModeStats &m = stats[i];
+    if (m.count == 0) continue;
+    LoopStatsFrame frame;
+    frame.mode = i;
+    frame.min_us = m.min_us;
+    frame.max_us = m.max_us;
+    frame.mean_us = m.sum_us / m.count;
+    frame.count = m.count;
+    memcpy(frame.buckets, m.buckets, sizeof(frame.buckets));
+    SerialLink::send_wait(FRAME_LOOP_STATS, &frame, sizeof(frame));
+  }
+}
+
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef LOOPSTATS_H
+#define LOOPSTATS_H
+#include <stdint.h>
+
+// Set to 1 to record loop timing. When 0, every function here compiles to nothing.
+#ifndef LOOP_STATS
+#define LOOP_STATS 0
+#endif
+
+#define LOOP_STATS_MAX_MODES 16 /** Modes with an id at or above this are not recorded */
+#define LOOP_STATS_BUCKETS 8 /** Bucket 0 is under 128 us, each following bucket doubles, the last is 8192 us and over */
+
+/**
+ * Payload of a FRAME_LOOP_STATS frame, one per mode that has samples. tools/loop_stats.py must be updated if this changes.
+ */
+typedef struct LoopStatsFrame {
+  uint8_t mode;       // Mode id
+  uint16_t min_us;    // Shortest loop iteration seen
+  uint16_t max_us;    // Longest loop iteration seen
+  uint16_t mean_us;   // Mean of the recorded iterations
+  uint16_t count;     // Number of iterations the mean and buckets cover
+  uint8_t buckets[LOOP_STATS_BUCKETS];  // Relative counts, halved together whenever one fills up
+} LoopStatsFrame;
+
+/**
+ * Per-mode loop iteration timing, kept in RAM as log-scaled histograms with min, max and mean.
+ */
+namespace LoopStats {
+#if LOOP_STATS
+  /**
+   * @brief Records the duration of one loop iteration.
+   * @param mode Id of the mode that ran during the iteration
+   * @param us Duration in microseconds
+   */
+  void record(uint8_t mode, uint16_t us);
+
+  /**
+   * @brief Clears all statistics.
+   */
+  void reset();
+
+  /**
+   * @brief Sends a FRAME_LOOP_STATS frame for every mode with samples. Blocks until all frames are queued.
+   */
+  void dump();
+#else
+  inline void record(uint8_t, uint16_t) {}
+  inline void reset() {}
+  inline void dump() {}
+#endif
+};
+
+#endif
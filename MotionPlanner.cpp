@@ -0,0 +1,180 @@
+#include "MotionPlanner.h"
+#include "kinematics.h"
+#include <math.h>
+#include <string.h>
+
+#define MOVE_EPSILON 0.00001 /** Joint distances below this in rad, or tip distances in mm, are treated as no move */
+#define LINE_Q1_CLEARANCE 0.01 /** How far in mm a line may cut into the points that need q1 past -PI, within what solve_ik clamps */
+
+namespace MotionPlanner {
+
+/**
+ * Tightens a limit of s to what one quantity's limit allows, given how much it changes per unit of s.
+ */
+static void limit(float &s_limit, float quantity_limit, float per_s) {
+  per_s = fabs(per_s);
+  if (per_s > MOVE_EPSILON && quantity_limit / per_s < s_limit) s_limit = quantity_limit / per_s;
+}
+
+/**
+ * Finds the minimum time profile of s for the limits of its speed, acceleration and jerk. Infinite speed or acceleration limits
+ * mean nothing has to move, and a jerk limit of 0 means none.
+ */
+static void time_path(PathTiming &timing, float speed, float accel, float jerk) {
+  memset(&timing, 0, sizeof(PathTiming));
+  if (isinf(speed) || isinf(accel)) { return; }
+  if (jerk <= 0) {
+    timing.accel = accel;
+    if (speed * speed >= accel) {
+      // Reaches the middle before full speed, so accelerate for half of s and decelerate for the rest
+      timing.t_accel = sqrt(1.0 / accel);
+      speed = accel * timing.t_accel;
+    } else {
+      timing.t_accel = speed / accel;
+    }
+  } else {
+    // Speed at which the whole of s is spent accelerating and decelerating, if full acceleration is reached
+    float top = 0.5 * (sqrt(accel * accel * accel * accel / (jerk * jerk) + 4 * accel) - accel * accel / jerk);
+    if (fmin(speed, top) * jerk >= accel * accel) {
+      speed = fmin(speed, top);
+      timing.t_jerk = accel / jerk;
+      timing.t_accel = timing.t_jerk + speed / accel;
+    } else {
+      // Full acceleration is not reached, so acceleration ramps up and straight back down
+      float no_accel_top = pow(0.5 * sqrt(jerk), 2.0 / 3.0);  // Top speed if the whole of s is spent ramping
+      if (no_accel_top < speed) speed = no_accel_top;
+      timing.t_jerk = sqrt(speed / jerk);
+      timing.t_accel = 2 * timing.t_jerk;
+      accel = jerk * timing.t_jerk;
+    }
+    timing.accel = accel;
+    timing.jerk = jerk;
+  }
+  timing.speed = speed;
+  timing.t_total = timing.t_accel + 1.0 / speed;  // Cruising takes 1 / speed less the time spent ramping speed
+}
+
+/**
+ * Finds s during the acceleration phase, at a time t since the start, for t from 0 to t_accel.
+ */
+static float accel_position(const PathTiming &timing, float t) {
+  if (timing.jerk == 0) {
+    return 0.5 * timing.accel * t * t;
+  }
+  if (t < timing.t_jerk) {
+    return timing.jerk * t * t * t * (1.0 / 6);
+  }
+  float t_left = timing.t_accel - t;
+  if (t_left < timing.t_jerk) {
+    // Mirror of the first ramp: speed approaches its top as acceleration ramps down
+    return timing.speed * (0.5 * timing.t_accel - t_left) + timing.jerk * t_left * t_left * t_left * (1.0 / 6);
+  }
+  // Constant acceleration, from the end of the first ramp
+  float t_ramp = timing.t_jerk;
+  float t_const = t - t_ramp;
+  return timing.accel * (t_ramp * t_ramp * (1.0 / 6) + 0.5 * t_ramp * t_const + 0.5 * t_const * t_const);
+}
+
+/**
+ * Finds s at a time since the start of the path.
+ * @return True if the path is done
+ */
+static bool path_position(const PathTiming &timing, float t, float &s) {
+  if (t >= timing.t_total) {
+    s = 1;
+    return true;
+  }
+  if (t < timing.t_accel) {
+    s = accel_position(timing, t);
+  } else if (t > timing.t_total - timing.t_accel) {
+    s = 1 - accel_position(timing, timing.t_total - t);  // Deceleration mirrors acceleration
+  } else {
+    s = timing.speed * (t - 0.5 * timing.t_accel);
+  }
+  return false;
+}
+
+void plan(JointMove &move, float q1_from, float q2_from, float q1_to, float q2_to, float scale) {
+  move.q1_from = q1_from;
+  move.q2_from = q2_from;
+  move.q1_delta = q1_to - q1_from;
+  move.q2_delta = q2_to - q2_from;
+
+  float speed = INFINITY, accel = INFINITY;
+  limit(speed, Q1_MAX_SPEED * scale, move.q1_delta);
+  limit(speed, Q2_MAX_SPEED * scale, move.q2_delta);
+  limit(accel, Q1_MAX_ACCEL * scale * scale, move.q1_delta);
+  limit(accel, Q2_MAX_ACCEL * scale * scale, move.q2_delta);
+  time_path(move.timing, speed, accel, 0);
+}
+
+bool sample(const JointMove &move, float t, float &q1, float &q2) {
+  float s;
+  bool done = path_position(move.timing, t, s);
+  q1 = move.q1_from + move.q1_delta * s;
+  q2 = move.q2_from + move.q2_delta * s;
+  return done;
+}
+
+/**
+ * Checks that a line stays out of the disk of points that would need q1 past -PI. The disk can lie between two check points of a
+ * line, with both ends outside it.
+ */
+static bool clears_q1_limit(float x_from, float y_from, float x_delta, float y_delta) {
+  // Nearest point of the line to the centre of the disk, at (-L1, 0)
+  float length_sq = x_delta * x_delta + y_delta * y_delta;
+  float s = (length_sq > 0) ? fmin(fmax(-((x_from + L1) * x_delta + y_from * y_delta) / length_sq, 0), 1) : 0;
+  float dx = x_from + x_delta * s + L1;
+  float dy = y_from + y_delta * s;
+  return dx * dx + dy * dy >= (L1 - LINE_Q1_CLEARANCE) * (L1 - LINE_Q1_CLEARANCE);
+}
+
+bool plan_line(LineMove &move, float x_from, float y_from, float x_to, float y_to, float q1_cur, float q2_cur, float scale,
+               float accel, float jerk) {
+  move.x_from = x_from;
+  move.y_from = y_from;
+  move.x_delta = x_to - x_from;
+  move.y_delta = y_to - y_from;
+  if (!clears_q1_limit(x_from, y_from, move.x_delta, move.y_delta)) { return false; }
+
+  // Steepest change of each joint and of the tilt per unit of s, from the joints at evenly spaced points
+  float q1_rate = 0, q2_rate = 0, turn_rate = 0;
+  float q1_prev = q1_cur, q2_prev = q2_cur;
+  for (uint8_t i = 1; i <= LINE_CHECK_POINTS; i++) {
+    float s = (float)i / LINE_CHECK_POINTS;
+    float q1_next, q2_next;
+    if (solve_ik(x_from + move.x_delta * s, y_from + move.y_delta * s, q1_prev, q2_prev, q1_next, q2_next) != IK_OK) {
+      return false;
+    }
+    float dq1 = (q1_next - q1_prev) * LINE_CHECK_POINTS;
+    float dq2 = (q2_next - q2_prev) * LINE_CHECK_POINTS;
+    q1_rate = fmax(q1_rate, fabs(dq1));
+    q2_rate = fmax(q2_rate, fabs(dq2));
+    turn_rate = fmax(turn_rate, fabs(dq1 + dq2));
+    q1_prev = q1_next;
+    q2_prev = q2_next;
+  }
+
+  float length = sqrt(move.x_delta * move.x_delta + move.y_delta * move.y_delta);
+  float s_speed = INFINITY, s_accel = INFINITY, s_jerk = INFINITY;
+  limit(s_speed, LINE_MAX_SPEED * scale, length);
+  limit(s_speed, Q1_MAX_SPEED * scale, q1_rate);
+  limit(s_speed, Q2_MAX_SPEED * scale, q2_rate);
+  limit(s_speed, LINE_MAX_TURN_RATE * scale, turn_rate);
+  limit(s_accel, accel * scale * scale, length);
+  limit(s_accel, Q1_MAX_ACCEL * scale * scale, q1_rate);
+  limit(s_accel, Q2_MAX_ACCEL * scale * scale, q2_rate);
+  if (jerk > 0) limit(s_jerk, jerk * scale * scale * scale, length);
+  time_path(move.timing, s_speed, s_accel, isinf(s_jerk) ? 0 : s_jerk);
+  return true;
+}
+
+bool sample_line(const LineMove &move, float t, float &x, float &y) {
+  float s;
+  bool done = path_position(move.timing, t, s);
+  x = move.x_from + move.x_delta * s;
+  y = move.y_from + move.y_delta * s;
+  return done;
+}
+
+};
@@ -0,0 +1,95 @@
+#ifndef MOTIONPLANNER_H
+#define MOTIONPLANNER_H
+#include <stdint.h>
+
+// Joint limits used for point-to-point moves. The shoulder carries the whole arm, so it is limited more than the elbow.
+#define Q1_MAX_SPEED 1.5 /** Max speed of joint 1, in rad/s */
+#define Q2_MAX_SPEED 2.0 /** Max speed of joint 2, in rad/s */
+#define Q1_MAX_ACCEL 6.0 /** Max acceleration of joint 1, in rad/s^2 */
+#define Q2_MAX_ACCEL 8.0 /** Max acceleration of joint 2, in rad/s^2 */
+
+// Limits of straight line moves, on top of the joint limits
+#define LINE_MAX_SPEED 150.0 /** Max speed of the spoon tip, in mm/s */
+#define LINE_MAX_ACCEL 400.0 /** Max acceleration of the spoon tip, in mm/s^2 */
+#define LINE_CARRY_ACCEL 250.0 /** Max acceleration of the spoon tip while it carries food, unless the profile sets one, in mm/s^2 */
+#define LINE_CARRY_JERK 2500.0 /** Max jerk of the spoon tip while it carries food, unless the profile sets one, in mm/s^3 */
+#define LINE_MAX_TURN_RATE 1.2 /** Max rate the spoon tilts (q1 + q2 changes) at, in rad/s. Tilting fast is what spills food. */
+#define LINE_CHECK_POINTS 8 /** Points along a line that are solved when it is planned, to check reach and find joint rates */
+
+/**
+ * Timing of the path parameter s, which goes from 0 to 1, starting and ending at rest. Without a jerk limit the speed profile is
+ * trapezoidal. With one, acceleration ramps up and down at the jerk limit, which makes an S-curve.
+ */
+typedef struct PathTiming {
+  float speed;    // Top speed of s, in 1/s
+  float accel;    // Top acceleration of s, in 1/s^2
+  float jerk;     // Jerk of s while acceleration ramps, in 1/s^3, or 0 for no limit
+  float t_jerk;   // Time spent ramping acceleration, at each end of the acceleration phase, in seconds
+  float t_accel;  // Time spent accelerating, and again decelerating, in seconds
+  float t_total;  // Duration of the move, in seconds
+} PathTiming;
+
+/**
+ * A planned point-to-point joint move. Both joints follow the same profile of s, so they start and arrive together and move on
+ * a straight line in joint space.
+ */
+typedef struct JointMove {
+  float q1_from, q2_from;    // Joint positions at the start
+  float q1_delta, q2_delta;  // Distance each joint moves
+  PathTiming timing;
+} JointMove;
+
+/**
+ * A planned straight line move of the spoon tip.
+ */
+typedef struct LineMove {
+  float x_from, y_from;    // Tip position at the start
+  float x_delta, y_delta;  // Distance the tip moves
+  PathTiming timing;
+} LineMove;
+
+/**
+ * Plans minimum-time moves within the speed and acceleration limits of the joints.
+ * A move is planned once, then sampled each loop with the time since it started, so its timing does not depend on the loop rate.
+ */
+namespace MotionPlanner {
+  /**
+   * @brief Plans a joint move from rest to rest.
+   * The limits of s are the tightest of the joints' limits divided by their distances, which is the fastest both joints can
+   * arrive together. The move is triangular if it is too short to reach full speed.
+   * @param move Written with the plan
+   * @param scale Scales the move's speed. Accelerations scale by its square, so the whole move is slowed evenly. Must be over 0.
+   */
+  void plan(JointMove &move, float q1_from, float q2_from, float q1_to, float q2_to, float scale);
+
+  /**
+   * @brief Finds the joint positions of a move at a time since it started.
+   * @param t Seconds since the move started
+   * @return True if the move is done. The positions are then the end of the move.
+   */
+  bool sample(const JointMove &move, float t, float &q1, float &q2);
+
+  /**
+   * @brief Plans a straight line move of the spoon tip from rest to rest.
+   * The line is solved at LINE_CHECK_POINTS points, following the elbow branch from the current joints. The steepest joint and
+   * tilt changes between them limit s along with the tip limits, so the line is as fast as the slowest part of it allows.
+   * @param move Written with the plan
+   * @param q1_cur Current q1, where the IK branch is followed from
+   * @param q2_cur Current q2, where the IK branch is followed from
+   * @param scale As for plan. Jerk scales by its cube.
+   * @param accel Acceleration limit of the tip, in mm/s^2
+   * @param jerk Jerk limit of the tip, in mm/s^3, or 0 for none. Limit jerk while the spoon carries food, so it does not slosh.
+   * @return False if part of the line cannot be reached, and move is not usable.
+   */
+  bool plan_line(LineMove &move, float x_from, float y_from, float x_to, float y_to, float q1_cur, float q2_cur, float scale,
+                 float accel, float jerk);
+
+  /**
+   * @brief Finds the tip position of a line move at a time since it started.
+   * @param t Seconds since the move started
+   * @return True if the move is done. The position is then the end of the move.
+   */
+  bool sample_line(const LineMove &move, float t, float &x, float &y);
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "MotionStream.h"
+#include "UnitState.h"
+
+static_assert((STREAM_BUFFER_SIZE & (STREAM_BUFFER_SIZE - 1)) == 0, "STREAM_BUFFER_SIZE must be a power of 2");
+
+namespace MotionStream {
+
+static UNIT_STATE StreamSetpoint buf[STREAM_BUFFER_SIZE];
+// Free running indexes, wrapped with a mask. head - tail is the number of buffered setpoints.
+static UNIT_STATE uint8_t head = 0;
+static UNIT_STATE uint8_t tail = 0;
+static UNIT_STATE uint16_t underrun_count = 0;
+
+void clear() {
+  head = tail = 0;
+  underrun_count = 0;
+}
+
+bool push(const StreamSetpoint &sp) {
+  if ((uint8_t)(head - tail) >= STREAM_BUFFER_SIZE) { return false; }
+  buf[head & (STREAM_BUFFER_SIZE - 1)] = sp;
+  head++;
+  return true;
+}
+
+bool pop(StreamSetpoint &sp) {
+  if (head == tail) { return false; }
+  sp = buf[tail & (STREAM_BUFFER_SIZE - 1)];
+  tail++;
+  return true;
+}
+
+uint8_t space() {
+  return STREAM_BUFFER_SIZE - (uint8_t)(head - tail);
+}
+
+void underrun() {
+  if (underrun_count < 0xFFFF) underrun_count++;
+}
+
+uint16_t underruns() {
+  return underrun_count;
+}
+
+}
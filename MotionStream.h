@@ -0,0 +1,62 @@
+#ifndef MOTIONSTREAM_H
+#define MOTIONSTREAM_H
+#include <stdint.h>
+
+#define STREAM_BUFFER_SIZE 16 /** Setpoints buffered ahead of the arm. Must be a power of 2. */
+#define STREAM_JOINT 0x01 /** FRAME_CMD_STREAM flag: setpoints are joint angles in mrad instead of x, y in 0.1 mm */
+
+/**
+ * A setpoint of a streamed trajectory, as sent in a FRAME_CMD_STREAM frame.
+ */
+typedef struct StreamSetpoint {
+  uint16_t dt_ms;  // Time to reach this setpoint from the previous one
+  int16_t a, b;    // x, y in 0.1 mm, or q1, q2 in mrad with STREAM_JOINT. Joint angles once buffered.
+} StreamSetpoint;
+
+/**
+ * Payload of a FRAME_STREAM_STATUS frame. tools/stream_motion.py must be updated if this changes.
+ */
+typedef struct StreamStatus {
+  uint8_t accepted;    // Setpoints taken from the last FRAME_CMD_STREAM frame. The rest must be sent again.
+  uint8_t space;       // Free slots in the buffer. The host must not send more setpoints than this.
+  uint16_t underruns;  // Times the buffer ran empty while streaming, since the stream started
+} StreamStatus;
+
+/**
+ * Ring buffer of streamed setpoints, filled from host frames and drained by stream_mode.
+ */
+namespace MotionStream {
+  /**
+   * @brief Empties the buffer and resets the underrun count.
+   */
+  void clear();
+
+  /**
+   * @brief Appends a setpoint.
+   * @return False if the buffer is full.
+   */
+  bool push(const StreamSetpoint &sp);
+
+  /**
+   * @brief Removes the oldest setpoint.
+   * @return False if the buffer is empty.
+   */
+  bool pop(StreamSetpoint &sp);
+
+  /**
+   * @return Number of free slots.
+   */
+  uint8_t space();
+
+  /**
+   * @brief Counts a buffer underrun.
+   */
+  void underrun();
+
+  /**
+   * @return Number of underruns since the last clear.
+   */
+  uint16_t underruns();
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "Power.h"
+#include "UnitState.h"
+#include "Sensors.h"
+#include <Arduino.h>
+
+namespace Power {
+
+static UNIT_STATE bool seeded = false;
+static UNIT_STATE unsigned long sample_time = 0;
+static UNIT_STATE float fast_v, fast_i;  // About 50 ms averages
+static UNIT_STATE float slow_v, slow_i;  // About 500 ms averages
+static UNIT_STATE float r = POWER_R_DEFAULT;
+
+void update() {
+  if (seeded && millis() - sample_time < POWER_SAMPLE_INTERVAL) { return; }
+  sample_time = millis();
+  float v = Sensors::servo_voltage();
+  float i = Sensors::servo_current();
+  if (!seeded) {
+    fast_v = slow_v = v;
+    fast_i = slow_i = i;
+    seeded = true;
+    return;
+  }
+  fast_v += (v - fast_v) * POWER_FAST_FILTER;
+  fast_i += (i - fast_i) * POWER_FAST_FILTER;
+  slow_v += (v - slow_v) * POWER_SLOW_FILTER;
+  slow_i += (i - slow_i) * POWER_SLOW_FILTER;
+  // A current step shows up in the fast averages first. The voltage moves the other way by the step times the internal resistance.
+  float di = fast_i - slow_i;
+  if (fabs(di) > POWER_R_STEP) {
+    float measured = (slow_v - fast_v) / di;
+    if (measured >= 0 && measured <= POWER_R_MAX) {
+      r += (measured - r) * POWER_R_FILTER;
+    }
+  }
+}
+
+uint16_t voltage() {
+  return fast_v;
+}
+
+uint16_t current() {
+  return fast_i;
+}
+
+float resting_voltage() {
+  return fast_v + r * fast_i;
+}
+
+float resistance() {
+  return r;
+}
+
+float speed_scale() {
+  float headroom = resting_voltage() - (LOW_POWER_VOLTAGE + POWER_HEADROOM);
+  return constrain(headroom / (r * POWER_PEAK_CURRENT), POWER_MIN_SPEED_SCALE, 1.0);
+}
+
+bool low() {
+  return seeded && (resting_voltage() < LOW_POWER_VOLTAGE || fast_v < LOW_POWER_VOLTAGE - POWER_BROWNOUT_MARGIN);
+}
+
+};
@@ -0,0 +1,63 @@
+#ifndef POWER_H
+#define POWER_H
+#include <stdint.h>
+
+// Voltages are in servo voltage sense units (about 102 per volt of battery), and currents in servo current sense units (337.6 per A).
+#define LOW_POWER_VOLTAGE 662 /** ((7.4V * 0.875))/2) * 1023/5 = 662, 7.4V is battery voltage, 0.875 is voltage cutoff ratio, 1023/5 remaps from voltage to analogRead value. */
+#define POWER_SAMPLE_INTERVAL 5 /** Milliseconds between voltage and current samples */
+#define POWER_FAST_FILTER 0.1 /** Weight of each sample in the fast averages, about 50 ms */
+#define POWER_SLOW_FILTER 0.01 /** Weight of each sample in the slow averages, about 500 ms */
+#define POWER_R_STEP 40 /** Fast and slow current must differ by this much to measure the internal resistance */
+#define POWER_R_FILTER 0.05 /** Weight of each internal resistance measurement */
+#define POWER_R_DEFAULT 0.1 /** Internal resistance before any measurement, in voltage units per current unit (about 0.33 ohm) */
+#define POWER_R_MAX 1.0 /** Measurements above this are treated as noise */
+#define POWER_PEAK_CURRENT 450 /** Servo current of a move at full speed */
+#define POWER_HEADROOM 10 /** Voltage kept above LOW_POWER_VOLTAGE at the predicted sag of a full speed move */
+#define POWER_MIN_SPEED_SCALE 0.3 /** speed_scale never goes below this */
+#define POWER_BROWNOUT_MARGIN 40 /** A sag this far below LOW_POWER_VOLTAGE is low power even while current flows */
+
+/**
+ * Tracks the servo supply, and limits speed to what the battery can deliver.
+ * The battery's resting voltage is estimated from the loaded voltage plus the sag over its internal resistance, which is measured
+ * whenever the servo current changes quickly. Low power is decided on the resting voltage, so the sag of a fast move does not trip it.
+ */
+namespace Power {
+  /**
+   * @brief Samples voltage and current every POWER_SAMPLE_INTERVAL ms. Call once per loop.
+   */
+  void update();
+
+  /**
+   * @return Filtered servo supply voltage
+   */
+  uint16_t voltage();
+
+  /**
+   * @return Filtered servo current
+   */
+  uint16_t current();
+
+  /**
+   * @return Estimated battery voltage with no load
+   */
+  float resting_voltage();
+
+  /**
+   * @return Estimated internal resistance, in voltage units per current unit
+   */
+  float resistance();
+
+  /**
+   * @brief Factor for speed limits, from POWER_MIN_SPEED_SCALE to 1.
+   * Full speed is allowed while a full speed move is predicted to keep the voltage POWER_HEADROOM above LOW_POWER_VOLTAGE.
+   * Below that, speed is reduced in proportion, since servo current grows with speed.
+   */
+  float speed_scale();
+
+  /**
+   * @return True if the battery is too low to keep running.
+   */
+  bool low();
+};
+
+#endif
@@ -1,77 +1,404 @@
 #include "Profile.h"
+#include "UnitState.h"
 #include "kinematics.h"
+#include "EEPROMMap.h"
+#include "Checksum.h"
 #include <Arduino.h>
 #include <EEPROM.h>
+#include <avr/pgmspace.h>
 
-#define PROFILE_EEPROM_START 0
-#define PROFILE_EEPROM_LEN 4
+// EEPROM layout of the profile store:
+// [StoreHeader][slot 0][slot 1]...[slot PROFILE_SLOTS-1]
+// Each slot holds one ProfileRecord. Saving a profile writes a new record with a higher sequence number to the next
+// slot that does not hold a live profile, so writes rotate through every slot instead of wearing out one address.
+// The live copy of a profile is the valid record with its id and the highest sequence number.
 
-Profile profiles[4];
+#define PROFILE_STORE_MAGIC 0xAF
+#define PROFILE_STORE_VERSION 3
+#define NO_SLOT 0xFF
+#define SEQ_RENUMBER_AT 0xFF00 /** Once the newest record reaches this sequence number, the live records are renumbered from 1 */
 
-Profile plate_profile = {
-  -80, -155,  // start
-  -76, -175,  // bottom
-  0, -177.5,    // middle
-  76, -180,   // front
-  80, -155    // end
+typedef struct StoreHeader {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t slot_size;
+  uint8_t num_slots;
+  uint8_t crc;
+} StoreHeader;
+
+// Each stored point packs a 12 bit coordinate with a nibble of the segment that starts at that point:
+// x holds the speed nibble, y holds the force nibble. The last point, which starts no segment, holds the carry byte the same way.
+#define COORD_MASK 0x0FFF
+#define NIBBLE_SHIFT 12
+
+typedef struct ProfileRecord {
+  uint16_t seq;        // Increases with every save. 0xFFFF is never written, so it marks erased EEPROM.
+  uint8_t id;          // Profile index
+  uint8_t num_points;
+  uint16_t points[MAX_PROFILE_POINTS][2];  // Packed x, y. Unused points are zero.
+  uint8_t crc;         // CRC of all previous fields
+} ProfileRecord;
+
+#define PROFILE_SLOTS ((EEPROM_PROFILE_LEN - sizeof(StoreHeader)) / sizeof(ProfileRecord))
+#define SLOT_ADDR(slot) (EEPROM_PROFILE_START + sizeof(StoreHeader) + sizeof(ProfileRecord) * (slot))
+
+static_assert(PROFILE_SLOTS > NUM_PROFILES, "Profile store needs at least one spare slot");
+static_assert(PROFILE_SLOTS < NO_SLOT, "Too many profile slots");
+
+// Profile directory: the slot holding the live copy of each profile, or NO_SLOT
+static UNIT_STATE uint8_t live_slot[NUM_PROFILES];
+static UNIT_STATE uint16_t last_seq = 0;            // Sequence number of the newest record
+static UNIT_STATE uint8_t next_slot = 0;            // Where the next save starts looking for a free slot
+
+static UNIT_STATE Profile active;                   // The active profile, decoded
+static UNIT_STATE uint8_t active_idx = NO_SLOT;     // Index of the active profile, or NO_SLOT
+static UNIT_STATE bool active_edited = false;       // True if active has edits that were not saved
+
+// Defaults live in flash, and are copied out when a profile is reset
+static const Profile plate_profile PROGMEM = {
+  5, {
+    { -800, -1550 },  // start
+    { -760, -1750 },  // bottom
+    { 0, -1775 },     // middle
+    { 760, -1800 },   // front
+    { 800, -1550 }    // end
+  }, {0}, 0
 };
 
-Profile bowl_profile = {
-  -75, -82.5,  // start
-  -70, -175,   // bottom
-  0, -175,     // middle
-  70, -175,    // front
-  60, -90      // end
+static const Profile bowl_profile PROGMEM = {
+  5, {
+    { -750, -825 },   // start
+    { -700, -1750 },  // bottom
+    { 0, -1750 },     // middle
+    { 700, -1750 },   // front
+    { 600, -900 }     // end
+  }, {0}, 0
 };
 
+/**
+ * Moves every point of a profile into the workspace.
+ */
+static void constrain_profile(Profile &p) {
+  for (uint8_t i = 0; i < p.num_points; i++) {
+    float x, y;
+    get_profile_point(p, i, x, y);
+    if (constrain_ik_point(x, y)) {
+      set_profile_point(p, i, x, y);
+    }
+  }
+}
+
+/**
+ * The lower half of each bank of profiles defaults to bowls, the upper half to plates.
+ */
+static Profile default_profile(uint8_t idx) {
+  Profile p;
+  memcpy_P(&p, (idx % PROFILES_PER_BANK < PROFILES_PER_BANK / 2) ? &bowl_profile : &plate_profile, sizeof(Profile));
+  constrain_profile(p);
+  return p;
+}
+
+static int16_t unpack_coord(uint16_t w) {
+  return (int16_t)(w << (16 - NIBBLE_SHIFT)) >> (16 - NIBBLE_SHIFT);  // Sign extend the low 12 bits
+}
+
+static void pack_record(const Profile &p, ProfileRecord &rec) {
+  memset(rec.points, 0, sizeof(rec.points));
+  rec.num_points = p.num_points;
+  for (uint8_t i = 0; i < p.num_points; i++) {
+    uint8_t seg = (i < p.num_points - 1) ? p.segments[i] : p.carry;
+    rec.points[i][0] = (p.points[i].x & COORD_MASK) | ((uint16_t)(seg >> 4) << NIBBLE_SHIFT);
+    rec.points[i][1] = (p.points[i].y & COORD_MASK) | ((uint16_t)(seg & 0x0F) << NIBBLE_SHIFT);
+  }
+}
+
+static void unpack_record(const ProfileRecord &rec, Profile &p) {
+  memset(&p, 0, sizeof(Profile));
+  p.num_points = rec.num_points;
+  for (uint8_t i = 0; i < rec.num_points; i++) {
+    p.points[i].x = unpack_coord(rec.points[i][0]);
+    p.points[i].y = unpack_coord(rec.points[i][1]);
+    uint8_t seg = ((rec.points[i][0] >> NIBBLE_SHIFT) << 4) | (rec.points[i][1] >> NIBBLE_SHIFT);
+    if (i < rec.num_points - 1) {
+      p.segments[i] = seg;
+    } else {
+      p.carry = seg;
+    }
+  }
+}
+
+/**
+ * Checks that a record is intact and describes a usable profile, then unpacks it and moves its points into the workspace.
+ */
+static bool verify_record(const ProfileRecord &rec, Profile &p) {
+  if (rec.seq == 0xFFFF || rec.id >= NUM_PROFILES) { return false; }
+  if (rec.num_points < MIN_PROFILE_POINTS || rec.num_points > MAX_PROFILE_POINTS) { return false; }
+  if (rec.crc != crc8(&rec, offsetof(ProfileRecord, crc))) { return false; }
+  unpack_record(rec, p);
+  constrain_profile(p);
+  return true;
+}
+
+static bool read_header_ok() {
+  StoreHeader h;
+  EEPROM.get(EEPROM_PROFILE_START, h);
+  return h.magic == PROFILE_STORE_MAGIC
+      && h.version == PROFILE_STORE_VERSION
+      && h.slot_size == sizeof(ProfileRecord)
+      && h.num_slots == PROFILE_SLOTS
+      && h.crc == crc8(&h, offsetof(StoreHeader, crc));
+}
+
+/**
+ * Writes a fresh header and invalidates every slot, so records from an older format are never read back.
+ */
+static void format_store() {
+  StoreHeader h = { PROFILE_STORE_MAGIC, PROFILE_STORE_VERSION, sizeof(ProfileRecord), PROFILE_SLOTS, 0 };
+  h.crc = crc8(&h, offsetof(StoreHeader, crc));
+  EEPROM.put(EEPROM_PROFILE_START, h);
+  for (uint8_t slot = 0; slot < PROFILE_SLOTS; slot++) {
+    EEPROM.update(SLOT_ADDR(slot) + offsetof(ProfileRecord, id), NO_SLOT);
+  }
+  last_seq = 0;
+  next_slot = 0;
+}
+
+static bool slot_in_use(uint8_t slot) {
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    if (live_slot[i] == slot) { return true; }
+  }
+  return false;
+}
+
+/**
+ * @return The next slot from next_slot that does not hold the live copy of any profile.
+ */
+static uint8_t find_free_slot() {
+  uint8_t slot = next_slot;
+  for (uint8_t tries = 0; tries < PROFILE_SLOTS && slot_in_use(slot); tries++) {
+    slot = (slot + 1) % PROFILE_SLOTS;
+  }
+  return slot;
+}
+
+/**
+ * Rewrites the live records with sequence numbers from 1, so saving can continue after about 65000 saves.
+ * Stale records are dropped first, so each profile has a single record. Each live record is then copied to a free slot with its
+ * new number before its old copy is dropped. If power fails in between, the old copy wins on load, and it holds the same profile.
+ */
+static void renumber_store() {
+  for (uint8_t slot = 0; slot < PROFILE_SLOTS; slot++) {
+    if (!slot_in_use(slot)) {
+      EEPROM.update(SLOT_ADDR(slot) + offsetof(ProfileRecord, id), NO_SLOT);
+    }
+  }
+  uint16_t seq = 0;
+  uint16_t max_seq = 0;  // Newest record that is live afterwards, which includes any old copy that could not be moved
+  ProfileRecord rec;
+  Profile p;
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    if (live_slot[i] == NO_SLOT) { continue; }
+    EEPROM.get(SLOT_ADDR(live_slot[i]), rec);
+    if (!verify_record(rec, p)) { continue; }
+    uint16_t old_seq = rec.seq;
+    rec.seq = ++seq;
+    rec.crc = crc8(&rec, offsetof(ProfileRecord, crc));
+    uint8_t slot = find_free_slot();
+    EEPROM.put(SLOT_ADDR(slot), rec);
+    EEPROM.get(SLOT_ADDR(slot), rec);
+    if (verify_record(rec, p)) {
+      EEPROM.update(SLOT_ADDR(live_slot[i]) + offsetof(ProfileRecord, id), NO_SLOT);
+      live_slot[i] = slot;
+      next_slot = (slot + 1) % PROFILE_SLOTS;
+      max_seq = max(max_seq, seq);
+    } else {
+      EEPROM.update(SLOT_ADDR(slot) + offsetof(ProfileRecord, id), NO_SLOT);
+      max_seq = max(max_seq, old_seq);
+    }
+  }
+  last_seq = max(max_seq, seq);
+}
+
+bool load_profiles() {
+  bool intact = true;
+  if (!read_header_ok()) {
+    format_store();
+    intact = false;
+  }
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    live_slot[i] = NO_SLOT;
+  }
+  uint16_t live_seq[NUM_PROFILES] = {0};
+  ProfileRecord rec;
+  Profile p;
+  for (uint8_t slot = 0; slot < PROFILE_SLOTS; slot++) {
+    EEPROM.get(SLOT_ADDR(slot), rec);
+    if (!verify_record(rec, p)) { continue; }
+    if (live_slot[rec.id] == NO_SLOT || rec.seq > live_seq[rec.id]) {
+      live_slot[rec.id] = slot;
+      live_seq[rec.id] = rec.seq;
+    }
+    if (rec.seq >= last_seq) {
+      last_seq = rec.seq;
+      next_slot = (slot + 1) % PROFILE_SLOTS;
+    }
+  }
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    if (live_slot[i] == NO_SLOT) {
+      save_profile(default_profile(i), i);
+      intact = false;
+    }
+  }
+  return intact;
+}
+
 void reset_profiles() {
   for (int i = 0; i < NUM_PROFILES; i++) {
-    profiles[i] = (i < NUM_PROFILES / 2) ? bowl_profile : plate_profile;
-    save_profile(profiles[i], i);
+    Profile p = default_profile(i);
+    Profile cur;
+    if (!load_profile(i, cur) || memcmp(&cur, &p, sizeof(Profile)) != 0) {
+      save_profile(p, i);
+    }
   }
 }
 
 bool save_profile(const Profile &p, uint8_t idx) {
-  if (idx >= PROFILE_EEPROM_LEN) { return false; }
-  EEPROM.put(PROFILE_EEPROM_START + (sizeof(Profile) * idx), p);
+  if (idx >= NUM_PROFILES) { return false; }
+  if (p.num_points < MIN_PROFILE_POINTS || p.num_points > MAX_PROFILE_POINTS) { return false; }
+  if (last_seq >= SEQ_RENUMBER_AT) {
+    renumber_store();
+  }
+  if (last_seq >= 0xFFFE) { return false; }
+  uint8_t slot = find_free_slot();
+  ProfileRecord rec;
+  rec.seq = last_seq + 1;
+  rec.id = idx;
+  pack_record(p, rec);
+  rec.crc = crc8(&rec, offsetof(ProfileRecord, crc));
+  EEPROM.put(SLOT_ADDR(slot), rec);  // put only writes the bytes that changed
+  // Read back before switching over, the previous copy stays live if the write failed
+  ProfileRecord check;
+  Profile check_p;
+  EEPROM.get(SLOT_ADDR(slot), check);
+  if (!verify_record(check, check_p)) { return false; }
+  last_seq = rec.seq;
+  next_slot = (slot + 1) % PROFILE_SLOTS;
+  live_slot[idx] = slot;
+  if (idx == active_idx) {
+    active = check_p;  // The only copy into the active profile outside of activate_profile
+    active_edited = false;
+  }
   return true;
 }
 
+bool activate_profile(uint8_t idx) {
+  if (idx == active_idx && !active_edited) { return true; }
+  if (!load_profile(idx, active)) { return false; }
+  active_idx = idx;
+  active_edited = false;
+  return true;
+}
+
+const Profile &active_profile() {
+  return active;
+}
+
+Profile &edit_active_profile() {
+  active_edited = true;
+  return active;
+}
+
 bool load_profile(uint8_t idx, Profile &p) {
-  if (idx >= PROFILE_EEPROM_LEN) { return false; }
-  EEPROM.get(PROFILE_EEPROM_START + (sizeof(Profile) * idx), p);
-  constrain_ik_point(p.entry_x, p.entry_y);
-  constrain_ik_point(p.bottom_x, p.bottom_y);
-  constrain_ik_point(p.middle_x, p.middle_y);
-  constrain_ik_point(p.front_x, p.front_y);
-  constrain_ik_point(p.end_y, p.end_y);
+  if (idx >= NUM_PROFILES || live_slot[idx] == NO_SLOT) { return false; }
+  ProfileRecord rec;
+  EEPROM.get(SLOT_ADDR(live_slot[idx]), rec);
+  Profile loaded;
+  if (!verify_record(rec, loaded) || rec.id != idx) { return false; }
+  p = loaded;
+  return true;
+}
+
+uint8_t encode_profile(const Profile &p, uint8_t *buf) {
+  uint8_t len = 0;
+  buf[len++] = p.num_points;
+  memcpy(buf + len, p.points, sizeof(ProfilePoint) * p.num_points);
+  len += sizeof(ProfilePoint) * p.num_points;
+  memcpy(buf + len, p.segments, p.num_points - 1);
+  len += p.num_points - 1;
+  buf[len++] = p.carry;
+  return len;
+}
+
+bool decode_profile(const uint8_t *buf, uint8_t len, Profile &p) {
+  if (len < 1) { return false; }
+  uint8_t n = buf[0];
+  if (n < MIN_PROFILE_POINTS || n > MAX_PROFILE_POINTS) { return false; }
+  uint8_t base_len = 1 + sizeof(ProfilePoint) * n + (n - 1);
+  if (len != base_len && len != base_len + 1) { return false; }
+  Profile decoded;
+  memset(&decoded, 0, sizeof(Profile));
+  decoded.num_points = n;
+  memcpy(decoded.points, buf + 1, sizeof(ProfilePoint) * n);
+  memcpy(decoded.segments, buf + 1 + sizeof(ProfilePoint) * n, n - 1);
+  if (len > base_len) decoded.carry = buf[base_len];
+  for (uint8_t i = 0; i < n; i++) {
+    if (abs(decoded.points[i].x) > PROFILE_COORD_LIMIT || abs(decoded.points[i].y) > PROFILE_COORD_LIMIT) { return false; }
+  }
+  p = decoded;
   return true;
 }
 
+bool get_profile_point(const Profile &p, int idx, float &x_addr, float &y_addr) {
+  if (idx < 0 || idx >= p.num_points) { return false; }
+  x_addr = p.points[idx].x * (1.0 / PROFILE_UNITS_PER_MM);
+  y_addr = p.points[idx].y * (1.0 / PROFILE_UNITS_PER_MM);
+  return true;
+}
+
+bool set_profile_point(Profile &p, int idx, float x, float y) {
+  if (idx < 0 || idx >= MAX_PROFILE_POINTS) { return false; }
+  p.points[idx].x = constrain(lround(x * PROFILE_UNITS_PER_MM), -PROFILE_COORD_LIMIT, PROFILE_COORD_LIMIT);
+  p.points[idx].y = constrain(lround(y * PROFILE_UNITS_PER_MM), -PROFILE_COORD_LIMIT, PROFILE_COORD_LIMIT);
+  return true;
+}
+
+float get_segment_speed(const Profile &p, int segment) {
+  if (segment < 0 || segment >= p.num_points - 1) { return 1.0; }
+  uint8_t speed = p.segments[segment] >> 4;
+  return (speed == 0) ? 1.0 : speed * (1.0 / SEGMENT_SPEED_UNITS);
+}
+
+int get_segment_force(const Profile &p, int segment, int default_force) {
+  if (segment < 0 || segment >= p.num_points - 1) { return default_force; }
+  uint8_t force = p.segments[segment] & 0x0F;
+  return (force == 0) ? default_force : force * SEGMENT_FORCE_UNITS;
+}
+
+bool set_segment(Profile &p, int segment, uint8_t speed, uint8_t force) {
+  if (segment < 0 || segment >= MAX_PROFILE_POINTS - 1) { return false; }
+  p.segments[segment] = ((speed & 0x0F) << 4) | (force & 0x0F);
+  return true;
+}
+
+float get_carry_accel(const Profile &p, float default_accel) {
+  uint8_t accel = p.carry >> 4;
+  return (accel == 0) ? default_accel : accel * CARRY_ACCEL_UNITS;
+}
+
+float get_carry_jerk(const Profile &p, float default_jerk) {
+  uint8_t jerk = p.carry & 0x0F;
+  return (jerk == 0) ? default_jerk : jerk * CARRY_JERK_UNITS;
+}
+
+void set_carry(Profile &p, uint8_t accel, uint8_t jerk) {
+  p.carry = ((accel & 0x0F) << 4) | (jerk & 0x0F);
+}
+
 bool get_profile_step(const Profile &p, int step, float &x_addr, float &y_addr) {
-  switch (step) {
-    case 0:
-      x_addr = p.entry_x;
-      y_addr = p.entry_y;
-      return true;
-    case 1:
-      x_addr = p.bottom_x;
-      y_addr = p.bottom_y;
-      return true;
-    case 2:
-      x_addr = p.middle_x;
-      y_addr = p.middle_y;
-      return true;
-    case 3:
-      x_addr = p.front_x;
-      y_addr = p.front_y;
-      return true;
-    case 4:
-      x_addr = p.end_x + 5;
-      y_addr = p.end_y + 20;
-      return true;
-    default:
-      return false;
+  if (!get_profile_point(p, step, x_addr, y_addr)) { return false; }
+  if (step == p.num_points - 1) {
+    x_addr += 5;
+    y_addr += 20;
   }
   return true;
-}
\ No newline at end of file
+}
@@ -2,25 +2,62 @@
 #define PROFILE_H
 #include <stdint.h>
 
-#define NUM_PROFILES 4
+#define NUM_PROFILES 20 /** Number of profiles in the store */
+#define PROFILES_PER_BANK 4 /** Profiles selectable with the potentiometer without changing bank */
+#define NUM_PROFILE_BANKS (NUM_PROFILES / PROFILES_PER_BANK) /** Banks are switched with the joystick in wait_mode */
+// The cap on keypoints is set by the EEPROM budget of the profile store: a record takes 5 bytes plus 4 per point, and
+// EEPROM_PROFILE_LEN (720 bytes) less the store header must hold more than NUM_PROFILES records, so saves have a free slot to go
+// to. At 6 points a record is 29 bytes and there are 24 slots for the 20 profiles. 7 points would leave a single spare slot for
+// wear levelling, and 8 would not fit at all.
+#define MAX_PROFILE_POINTS 6 /** Most keypoints a profile can have */
+#define MIN_PROFILE_POINTS 2 /** A profile needs at least an entry and an end */
+#define PROFILE_UNITS_PER_MM 10 /** Profile coordinates are stored in 0.1 mm */
+#define PROFILE_COORD_LIMIT 2047 /** Coordinates are stored in 12 bits, so they are limited to +-204.7 mm */
+#define SEGMENT_SPEED_UNITS 8 /** Segment speed scale = speed / SEGMENT_SPEED_UNITS, so 8 is normal speed */
+#define SEGMENT_FORCE_UNITS 32 /** Segment contact threshold = force * SEGMENT_FORCE_UNITS, in analogRead units */
+#define CARRY_ACCEL_UNITS 50 /** Spoon acceleration limit while carrying food = accel * CARRY_ACCEL_UNITS, in mm/s^2 */
+#define CARRY_JERK_UNITS 500 /** Spoon jerk limit while carrying food = jerk * CARRY_JERK_UNITS, in mm/s^3 */
 
+#define PROFILE_ENCODED_MAX (1 + MAX_PROFILE_POINTS * 4 + MAX_PROFILE_POINTS - 1 + 1) /** Longest output of encode_profile */
+
+/**
+ * A keypoint in profile units. The workspace is within L1 + L2 = 200 mm of the shoulder, so coordinates stay within +-2000.
+ */
+typedef struct ProfilePoint {
+  int16_t x, y;
+} ProfilePoint;
+
+/**
+ * Keypoints of a scooping path. The first point is the entry, the last is the end, and the points in between are scraped in order.
+ * Segment i runs from point i to point i + 1. Its byte holds a speed nibble (high) and a force nibble (low),
+ * where 0 means the default speed or contact threshold.
+ * The carry byte limits how hard the spoon is moved while it carries food from this plate or bowl: an acceleration nibble (high)
+ * and a jerk nibble (low), where 0 means the default limit.
+ */
 typedef struct Profile {
-  float entry_x, entry_y;
-  float bottom_x, bottom_y;
-  float middle_x, middle_y;
-  float front_x, front_y;
-  float end_x, end_y;
+  uint8_t num_points;
+  ProfilePoint points[MAX_PROFILE_POINTS];
+  uint8_t segments[MAX_PROFILE_POINTS - 1];
+  uint8_t carry;
 } Profile;
 
-extern Profile profiles[4];
+/**
+ * @brief Reads the whole profile store from EEPROM in a single verified pass and builds the profile directory.
+ * Profiles that are missing or fail verification are replaced with defaults and saved.
+ * If the store was written by a different format version, it is formatted first.
+ * @return True if every profile was found in EEPROM without repair.
+ */
+bool load_profiles();
 
 /**
- * @brief Resets all profiles and saves to EEPROM.
+ * @brief Resets all profiles to defaults. Only profiles that differ from their default are saved to EEPROM.
  */
 void reset_profiles();
 
 /**
  * @brief Saves a profile to an index in EEPROM. Returns if the save was successful.
+ * The profile is written to the next free slot of the store, so repeated saves are spread across the EEPROM.
+ * Saving the active profile's index also updates the active profile.
  * @param p Profile to save
  * @param idx Profile index to overwrite in EEPROM
  * @return True if successful
@@ -31,11 +68,102 @@ bool save_profile(const Profile &p, uint8_t idx);
  * @brief Loads a profile from a specified index in EEPROM.
  * @param idx Profile index in EEPROM
  * @param p Pointer to Profile struct to initialize.
- * @return True if the load was successful.
+ * @return True if the load was successful. If false, p is left unmodified.
  */
 bool load_profile(uint8_t idx, Profile &p);
 
 /**
+ * @brief Makes a profile the active one, the profile the arm scoops with. The active profile is kept decoded in RAM,
+ * so it is only read from EEPROM when the selection changes, or after it was edited without saving.
+ * @param idx Profile index
+ * @return True if the profile is active. If false, the previous one stays active.
+ */
+bool activate_profile(uint8_t idx);
+
+/**
+ * @return The active profile. It stays valid and is updated in place when the active profile changes or is saved.
+ */
+const Profile &active_profile();
+
+/**
+ * @brief Gives write access to the active profile, for building a new version of it in place.
+ * Commit the edits with save_profile(edit_active_profile(), idx). Uncommitted edits are discarded by the next activate_profile.
+ */
+Profile &edit_active_profile();
+
+/**
+ * @brief Encodes a profile for the serial link: [num_points][x, y as int16 for each point][segment byte for each segment][carry byte]
+ * @param p Profile to encode
+ * @param buf Destination, must hold PROFILE_ENCODED_MAX bytes
+ * @return Number of bytes written
+ */
+uint8_t encode_profile(const Profile &p, uint8_t *buf);
+
+/**
+ * @brief Decodes a profile written by encode_profile. The carry byte may be left out, and is then 0.
+ * @return True if the data is a complete profile with a valid point count and coordinates. If false, p is left unmodified.
+ */
+bool decode_profile(const uint8_t *buf, uint8_t len, Profile &p);
+
+/**
+ * @brief Converts a keypoint of a profile to mm.
+ * @param p Profile to read
+ * @param idx Index of keypoint
+ * @param x_addr x value to initialize
+ * @param y_addr y value to initialize
+ * @returns True if the keypoint exists. If false, x_addr and y_addr are left unmodified.
+ */
+bool get_profile_point(const Profile &p, int idx, float &x_addr, float &y_addr);
+
+/**
+ * @brief Sets a keypoint of a profile from a position in mm, rounded to profile units.
+ * @returns True if the index is within MAX_PROFILE_POINTS.
+ */
+bool set_profile_point(Profile &p, int idx, float x, float y);
+
+/**
+ * @param p Profile to read
+ * @param segment Index of segment, which ends at keypoint segment + 1
+ * @returns Speed scale of the segment, 1.0 if it uses the default speed.
+ */
+float get_segment_speed(const Profile &p, int segment);
+
+/**
+ * @param p Profile to read
+ * @param segment Index of segment, which ends at keypoint segment + 1
+ * @param default_force Threshold to return if the segment does not set one
+ * @returns Current above which the spoon is considered to be pressing into the bowl/plate on this segment, in analogRead units.
+ */
+int get_segment_force(const Profile &p, int segment, int default_force);
+
+/**
+ * @brief Sets the speed and force nibbles of a segment, each from 0 to 15.
+ * @returns True if the segment exists.
+ */
+bool set_segment(Profile &p, int segment, uint8_t speed, uint8_t force);
+
+/**
+ * @param p Profile to read
+ * @param default_accel Limit to return if the profile does not set one
+ * @returns Acceleration limit of the spoon while it carries food, in mm/s^2.
+ */
+float get_carry_accel(const Profile &p, float default_accel);
+
+/**
+ * @param p Profile to read
+ * @param default_jerk Limit to return if the profile does not set one
+ * @returns Jerk limit of the spoon while it carries food, in mm/s^3.
+ */
+float get_carry_jerk(const Profile &p, float default_jerk);
+
+/**
+ * @brief Sets the acceleration and jerk nibbles of the carry byte, each from 0 to 15.
+ */
+void set_carry(Profile &p, uint8_t accel, uint8_t jerk);
+
+/**
+ * @brief Returns the target of a step of the scooping path. Steps are the keypoints in order, except that the last step
+ * finishes slightly beyond and above the end point to lift out of the bowl/plate.
  * @param p Profile to read
  * @param step Index of step
  * @param x_addr x value to initialize
@@ -44,4 +172,4 @@ bool load_profile(uint8_t idx, Profile &p);
  */
 bool get_profile_step(const Profile &p, int step, float &x_addr, float &y_addr);
 
-#endif
\ No newline at end of file
+#endif
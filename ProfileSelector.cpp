@@ -0,0 +1,99 @@
+#include "ProfileSelector.h"
+#include "UnitState.h"
+#include "Profile.h"
+#include <Arduino.h>
+
+#define NO_HOST_PROFILE 0xFF
+
+namespace ProfileSelector {
+
+static UNIT_STATE float reading = 0;                 // Filtered potentiometer reading
+static UNIT_STATE uint8_t cur_detent = 0;
+static UNIT_STATE uint8_t cur_bank = 0;
+static UNIT_STATE uint8_t host_idx = NO_HOST_PROFILE; // Profile activated by the host, or NO_HOST_PROFILE
+static UNIT_STATE uint8_t host_detent = 0;           // Detent when the host activated its profile
+static UNIT_STATE uint8_t last_choice = 0;
+static UNIT_STATE bool change_pending = false;
+static UNIT_STATE unsigned long last_sample = 0;     // millis() of the last sample
+
+/**
+ * Finds the detent of a reading, without hysteresis.
+ */
+static uint8_t nearest_detent(float value) {
+  int idx = (value - (SELECTOR_FIRST_CENTER - SELECTOR_DETENT_WIDTH / 2)) / SELECTOR_DETENT_WIDTH;
+  return constrain(idx, 0, PROFILES_PER_BANK - 1);
+}
+
+/**
+ * Moves to another detent only once the reading is SELECTOR_HYSTERESIS past the current detent's band.
+ */
+static void update_detent() {
+  float low = SELECTOR_FIRST_CENTER - SELECTOR_DETENT_WIDTH / 2 + (float)cur_detent * SELECTOR_DETENT_WIDTH;
+  float high = low + SELECTOR_DETENT_WIDTH;
+  bool below = cur_detent > 0 && reading < low - SELECTOR_HYSTERESIS;
+  bool above = cur_detent < PROFILES_PER_BANK - 1 && reading > high + SELECTOR_HYSTERESIS;
+  if (below || above) {
+    cur_detent = nearest_detent(reading);
+  }
+}
+
+/**
+ * Recomputes the choice, and raises the change event if it is different.
+ */
+static void update_choice() {
+  if (host_idx != NO_HOST_PROFILE && cur_detent != host_detent) {
+    host_idx = NO_HOST_PROFILE;
+  }
+  uint8_t c = choice();
+  if (c != last_choice) {
+    last_choice = c;
+    change_pending = true;
+  }
+}
+
+void begin() {
+  reading = analogRead(PROFILE_POT_PIN);
+  cur_detent = nearest_detent(reading);
+  last_choice = choice();
+  last_sample = millis();
+}
+
+void update() {
+  if (millis() - last_sample < SELECTOR_SAMPLE_INTERVAL) { return; }
+  last_sample = millis();
+  reading += SELECTOR_FILTER * (analogRead(PROFILE_POT_PIN) - reading);
+  update_detent();
+  update_choice();
+}
+
+uint8_t detent() {
+  return cur_detent;
+}
+
+uint8_t bank() {
+  return cur_bank;
+}
+
+void set_bank(uint8_t bank) {
+  cur_bank = bank % NUM_PROFILE_BANKS;
+  host_idx = NO_HOST_PROFILE;
+  update_choice();
+}
+
+void host_select(uint8_t idx) {
+  host_idx = idx;
+  host_detent = cur_detent;
+  last_choice = choice();
+}
+
+uint8_t choice() {
+  return (host_idx != NO_HOST_PROFILE) ? host_idx : cur_bank * PROFILES_PER_BANK + cur_detent;
+}
+
+bool changed() {
+  bool c = change_pending;
+  change_pending = false;
+  return c;
+}
+
+};
@@ -0,0 +1,60 @@
+#ifndef PROFILESELECTOR_H
+#define PROFILESELECTOR_H
+#include <stdint.h>
+
+#define PROFILE_POT_PIN 5 /** Analog input pin for the profile potentiometer */
+#define SELECTOR_SAMPLE_INTERVAL 10 /** Milliseconds between potentiometer samples */
+#define SELECTOR_FILTER 0.2 /** Weight of each sample in the filtered reading, about 50 ms */
+#define SELECTOR_FIRST_CENTER 476 /** Reading at the center of the first detent */
+#define SELECTOR_DETENT_WIDTH 146 /** Average difference between detent centers */
+#define SELECTOR_HYSTERESIS 20 /** How far past the edge of its band the reading must go before the detent changes */
+
+/**
+ * Profile selection from the potentiometer and the bank, sampled in the background.
+ * The reading is filtered, and each detent keeps a hysteresis band around it, so a knob resting on a boundary does not flicker
+ * between profiles. A profile activated by the host overrides the potentiometer until the knob is turned to another detent.
+ */
+namespace ProfileSelector {
+  /**
+   * @brief Starts the filter from a fresh reading, so the first choice is valid immediately. Call once at startup.
+   */
+  void begin();
+
+  /**
+   * @brief Samples the potentiometer every SELECTOR_SAMPLE_INTERVAL ms and updates the choice. Never waits. Call once per loop.
+   */
+  void update();
+
+  /**
+   * @return Detent of the potentiometer, from 0 to PROFILES_PER_BANK - 1
+   */
+  uint8_t detent();
+
+  /**
+   * @return Bank of PROFILES_PER_BANK profiles that the potentiometer selects from
+   */
+  uint8_t bank();
+
+  /**
+   * @brief Changes the bank, and drops a profile activated by the host.
+   */
+  void set_bank(uint8_t bank);
+
+  /**
+   * @brief Makes a profile the choice until the potentiometer is turned to another detent or the bank is changed.
+   * Does not raise a change event, since the host already knows.
+   */
+  void host_select(uint8_t idx);
+
+  /**
+   * @return The chosen profile index, from 0 to NUM_PROFILES - 1
+   */
+  uint8_t choice();
+
+  /**
+   * @return True once after the choice changed, then false until it changes again.
+   */
+  bool changed();
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "ScoopLearning.h"
+#include "UnitState.h"
+#include "Profile.h"
+#include "EEPROMMap.h"
+#include "Checksum.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#define NOT_LEARNED 0xFF
+#define NUM_SEGMENTS (MAX_PROFILE_POINTS - 1)
+
+typedef struct LearnRecord {
+  uint8_t offset[NUM_SEGMENTS];  // In 1 / LEARN_UNITS_PER_MM mm, or NOT_LEARNED
+  uint8_t crc;                   // CRC of the offsets, seeded with the profile index so rows cannot be swapped
+} LearnRecord;
+
+#define RECORD_ADDR(profile) (EEPROM_SCOOP_LEARN_START + sizeof(LearnRecord) * (profile))
+
+static_assert(sizeof(LearnRecord) * NUM_PROFILES <= EEPROM_SCOOP_LEARN_LEN, "Scoop learning does not fit its EEPROM region");
+
+namespace ScoopLearning {
+
+static UNIT_STATE uint8_t selected = 0xFF;  // Profile whose offsets are in row, or 0xFF before the first select
+static UNIT_STATE LearnRecord row;
+static UNIT_STATE uint8_t unsaved = 0;      // Scoops that changed row since it was written
+// Observations of the scoop in progress
+static UNIT_STATE uint8_t observed[NUM_SEGMENTS];
+static UNIT_STATE bool contact[NUM_SEGMENTS];
+
+static uint8_t row_crc(uint8_t profile, const LearnRecord &rec) {
+  return crc8(rec.offset, sizeof(rec.offset), profile);
+}
+
+void select(uint8_t profile) {
+  if (profile == selected) { return; }
+  save(true);
+  selected = profile;
+  unsaved = 0;
+  discard();
+  EEPROM.get(RECORD_ADDR(profile), row);
+  if (row.crc != row_crc(profile, row)) {
+    memset(row.offset, NOT_LEARNED, sizeof(row.offset));
+  }
+}
+
+float offset(uint8_t seg) {
+  if (seg >= NUM_SEGMENTS || row.offset[seg] == NOT_LEARNED) { return -1; }
+  return row.offset[seg] * (1.0 / LEARN_UNITS_PER_MM);
+}
+
+void observe(uint8_t seg, float y_off, bool had_contact) {
+  if (seg >= NUM_SEGMENTS) { return; }
+  observed[seg] = constrain(lround(y_off * LEARN_UNITS_PER_MM), 0, NOT_LEARNED - 1);
+  contact[seg] = had_contact;
+}
+
+void finish() {
+  bool changed = false;
+  for (uint8_t i = 0; i < NUM_SEGMENTS; i++) {
+    if (observed[i] == NOT_LEARNED) { continue; }
+    uint8_t learned = observed[i];
+    if (!contact[i]) {
+      // Nothing was hit at this height, so probe a little lower next time
+      learned = learned > LEARN_DECAY ? learned - LEARN_DECAY : 0;
+    }
+    if (learned != row.offset[i]) {
+      row.offset[i] = learned;
+      changed = true;
+    }
+  }
+  discard();
+  if (changed && unsaved < 0xFF) unsaved++;
+}
+
+void discard() {
+  memset(observed, NOT_LEARNED, sizeof(observed));
+}
+
+void save(bool force) {
+  if (selected == 0xFF || unsaved == 0 || (!force && unsaved < LEARN_SAVE_SCOOPS)) { return; }
+  row.crc = row_crc(selected, row);
+  EEPROM.put(RECORD_ADDR(selected), row);
+  unsaved = 0;
+}
+
+void forget(uint8_t profile) {
+  LearnRecord rec;
+  memset(rec.offset, NOT_LEARNED, sizeof(rec.offset));
+  rec.crc = row_crc(profile, rec);
+  EEPROM.put(RECORD_ADDR(profile), rec);
+  if (profile == selected) {
+    row = rec;
+    unsaved = 0;
+    discard();
+  }
+}
+
+};
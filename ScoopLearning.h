@@ -0,0 +1,58 @@
+#ifndef SCOOPLEARNING_H
+#define SCOOPLEARNING_H
+#include <stdint.h>
+
+#define LEARN_UNITS_PER_MM 4 /** Learned offsets are stored in 0.25 mm, up to 63.5 mm */
+#define LEARN_DECAY 1 /** Units an offset is lowered after a segment is scraped without contact, so scoops keep reaching the floor as food runs out */
+#define LEARN_SAVE_SCOOPS 8 /** Learned offsets of the selected profile are written after this many scoops, or when another profile is selected */
+
+/**
+ * Learned scoop height offsets, one per segment of each profile.
+ * scoop_step raises the spoon whenever it meets resistance. The offset a segment needed on the last scoop is remembered,
+ * so the next scoop starts each segment at that height instead of probing for the floor again.
+ * Offsets of the selected profile are kept in RAM, and written to EEPROM in batches while the arm waits at home.
+ */
+namespace ScoopLearning {
+  /**
+   * @brief Makes a profile's offsets current, first writing those of the previous profile if they changed.
+   * Offsets that are missing or corrupted in EEPROM start out unlearned.
+   */
+  void select(uint8_t profile);
+
+  /**
+   * @param seg Segment index, 0 for the segment from the first to the second point
+   * @return Learned offset of a segment of the selected profile in mm, or a negative value if it has not been learned yet.
+   */
+  float offset(uint8_t seg);
+
+  /**
+   * @brief Records how a segment went in the current scoop. Takes effect when the scoop finishes.
+   * @param seg Segment index
+   * @param y_off Offset in mm at which the segment was completed
+   * @param contact True if the spoon had to back off during the segment
+   */
+  void observe(uint8_t seg, float y_off, bool contact);
+
+  /**
+   * @brief Learns from the observations of a scoop that completed. Observations of a cancelled scoop are simply never finished.
+   */
+  void finish();
+
+  /**
+   * @brief Discards the observations of the current scoop.
+   */
+  void discard();
+
+  /**
+   * @brief Writes the selected profile's offsets if LEARN_SAVE_SCOOPS scoops have changed them. Waits for the EEPROM.
+   * @param force Write after any change
+   */
+  void save(bool force = false);
+
+  /**
+   * @brief Forgets the offsets of a profile, for when its points change.
+   */
+  void forget(uint8_t profile);
+};
+
+#endif
@@ -0,0 +1,18 @@
+#include "Sensors.h"
+#include <Arduino.h>
+
+namespace Sensors {
+
+uint16_t servo_current() {
+  return analogRead(SERVO_CURRENT_PIN);
+}
+
+uint16_t motor_current() {
+  return analogRead(MOTOR_CURRENT_PIN);
+}
+
+uint16_t servo_voltage() {
+  return analogRead(SERVO_VOLTAGE_PIN);
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+#include <stdint.h>
+
+#define SERVO_CURRENT_PIN 0 /** Analog input pin for servo current sensing */
+#define MOTOR_CURRENT_PIN 1 /** Analog input pin for DC motor current sensing */
+#define SERVO_VOLTAGE_PIN 4 /** Analog input pin for voltage divider */
+
+/**
+ * Power sensing inputs. All code reads the current and voltage sense pins through here, so the readings can be replaced
+ * by a model when running without hardware.
+ */
+namespace Sensors {
+  /**
+   * @return Servo current sense, in analogRead units
+   */
+  uint16_t servo_current();
+
+  /**
+   * @return DC motor current sense, in analogRead units
+   */
+  uint16_t motor_current();
+
+  /**
+   * @return Servo supply voltage sense, in analogRead units
+   */
+  uint16_t servo_voltage();
+};
+
+#endif
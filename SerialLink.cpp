@@ -0,0 +1,69 @@
+#include "SerialLink.h"
+#include "UnitState.h"
+#include "Checksum.h"
+#include <Arduino.h>
+
+namespace SerialLink {
+
+static UNIT_STATE uint16_t dropped_frames = 0;
+// Receive state: bytes of the frame being received, after the sync byte
+static UNIT_STATE uint8_t rx_buf[FRAME_MAX_PAYLOAD + 3];
+static UNIT_STATE uint8_t rx_pos = 0;
+static UNIT_STATE bool rx_synced = false;
+
+void begin() {
+  Serial.begin(SERIAL_LINK_BAUD);
+}
+
+bool send(uint8_t type, const void *payload, uint8_t len) {
+  if (len > FRAME_MAX_PAYLOAD || Serial.availableForWrite() < len + FRAME_OVERHEAD) {
+    dropped_frames++;
+    return false;
+  }
+  uint8_t head[3] = { FRAME_SYNC, type, len };
+  uint8_t crc = crc8(head + 1, 2);
+  crc = crc8(payload, len, crc);
+  Serial.write(head, 3);
+  Serial.write((const uint8_t *)payload, len);
+  Serial.write(crc);
+  return true;
+}
+
+bool send_wait(uint8_t type, const void *payload, uint8_t len) {
+  if (len > FRAME_MAX_PAYLOAD) { return false; }
+  while (Serial.availableForWrite() < len + FRAME_OVERHEAD) {}
+  return send(type, payload, len);
+}
+
+uint16_t dropped() {
+  return dropped_frames;
+}
+
+bool receive(uint8_t &type, const uint8_t *&payload, uint8_t &len) {
+  while (Serial.available() > 0) {
+    uint8_t b = Serial.read();
+    if (!rx_synced) {
+      rx_synced = (b == FRAME_SYNC);
+      rx_pos = 0;
+      continue;
+    }
+    rx_buf[rx_pos++] = b;
+    // rx_buf holds [type][len][payload...][crc]
+    if (rx_pos == 2 && rx_buf[1] > FRAME_MAX_PAYLOAD) {
+      rx_synced = (b == FRAME_SYNC);
+      rx_pos = 0;
+      continue;
+    }
+    if (rx_pos >= 3 && rx_pos == rx_buf[1] + 3) {
+      rx_synced = false;
+      if (crc8(rx_buf, rx_pos - 1) != rx_buf[rx_pos - 1]) { continue; }
+      type = rx_buf[0];
+      len = rx_buf[1];
+      payload = rx_buf + 2;
+      return true;
+    }
+  }
+  return false;
+}
+
+};
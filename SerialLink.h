@@ -0,0 +1,80 @@
+#ifndef SERIALLINK_H
+#define SERIALLINK_H
+#include <stdint.h>
+
+#define SERIAL_LINK_BAUD 115200
+#define FRAME_SYNC 0xA5 /** First byte of every frame */
+#define FRAME_MAX_PAYLOAD 32 /** Longest payload a frame can carry */
+#define FRAME_OVERHEAD 4 /** Sync, type, length and CRC bytes around the payload */
+
+// Frame types sent by the device
+#define FRAME_TELEMETRY 0x01
+#define FRAME_LOOP_STATS 0x02
+#define FRAME_EVENT 0x03
+#define FRAME_ACK 0x04 /** Reply to a command that has no data to return. Payload: [command type][ACK_* status] */
+#define FRAME_PROFILE_LIST 0x05 /** Payload: [active profile][point count of each profile, 0 if missing...] */
+#define FRAME_PROFILE 0x06 /** Payload: [profile index][encoded profile, see encode_profile] */
+#define FRAME_SERVO_CAL 0x07 /** Payload: [servo][pulse width of each calibration point, uint16 ticks...] */
+#define FRAME_STREAM_STATUS 0x08 /** Reply to FRAME_CMD_STREAM. Payload: StreamStatus */
+
+// Frame types sent by the host
+#define FRAME_CMD_LOOP_STATS 0x81 /** Request a loop statistics dump. Payload: optional byte, nonzero resets the statistics after the dump */
+#define FRAME_CMD_EVENT_LOG 0x82 /** Request the event log, oldest event first. Payload: optional byte, nonzero clears the log after the dump. Only while the arm is waiting at home or in a transaction. */
+#define FRAME_CMD_LIST 0x83 /** Request FRAME_PROFILE_LIST */
+#define FRAME_CMD_READ_PROFILE 0x84 /** Request FRAME_PROFILE. Payload: [profile index] */
+#define FRAME_CMD_WRITE_PROFILE 0x85 /** Save a profile. Payload: same as FRAME_PROFILE. Only inside a transaction. */
+#define FRAME_CMD_ACTIVATE 0x86 /** Select a profile until the potentiometer is moved. Payload: [profile index]. Only while the arm is waiting at home or in a transaction. */
+#define FRAME_CMD_READ_CAL 0x87 /** Request FRAME_SERVO_CAL. Payload: [servo] */
+#define FRAME_CMD_WRITE_CAL 0x88 /** Save a servo calibration table. Payload: same as FRAME_SERVO_CAL. Only inside a transaction. */
+#define FRAME_CMD_BEGIN 0x89 /** Start a transaction: the arm must be waiting at home, and stays still until FRAME_CMD_END */
+#define FRAME_CMD_END 0x8A /** End a transaction and reload the selected profile, or end a stream and return home */
+#define FRAME_CMD_STREAM 0x8B /** Queue setpoints for stream_mode, starting it if the arm is waiting at home. Payload: [STREAM_* flags][StreamSetpoint...] */
+#define FRAME_CMD_TELEMETRY 0x8C /** Set the time between telemetry frames until reset. Payload: uint16 ms, 0 stops telemetry */
+
+// Status codes of FRAME_ACK
+#define ACK_OK 0
+#define ACK_BAD_REQUEST 1 /** Unknown command, or a payload that is malformed or out of range */
+#define ACK_BUSY 2 /** The command needs a transaction, or cannot be run while the arm is moving */
+#define ACK_WRITE_FAILED 3 /** EEPROM write or verification failed, or the data was rejected when saving */
+
+/**
+ * Framed binary link to a host over the hardware serial port (pins 0 and 1).
+ * Frame layout: [FRAME_SYNC][type][payload length][payload...][CRC-8 of type, length and payload]
+ * Multi-byte values in payloads are little endian, the native byte order of the AVR.
+ */
+namespace SerialLink {
+  /**
+   * @brief Opens the serial port at SERIAL_LINK_BAUD.
+   */
+  void begin();
+
+  /**
+   * @brief Queues a frame for transmission without blocking.
+   * Bytes are sent from the serial driver's transmit buffer by its interrupt, so this only copies the frame.
+   * If the whole frame does not fit in the free space of the buffer, it is dropped instead of waiting.
+   * @return True if the frame was queued.
+   */
+  bool send(uint8_t type, const void *payload, uint8_t len);
+
+  /**
+   * @brief Sends a frame, waiting for room in the transmit buffer. Use for replies that must not be lost.
+   * @return False if the payload is too long.
+   */
+  bool send_wait(uint8_t type, const void *payload, uint8_t len);
+
+  /**
+   * @return Number of frames dropped because the transmit buffer was full.
+   */
+  uint16_t dropped();
+
+  /**
+   * @brief Reads any received bytes without blocking, and returns the next complete frame with a valid CRC.
+   * @param type Set to the frame type
+   * @param payload Set to point at the payload, which stays valid until the next call
+   * @param len Set to the payload length
+   * @return True if a frame was received.
+   */
+  bool receive(uint8_t &type, const uint8_t *&payload, uint8_t &len);
+};
+
+#endif
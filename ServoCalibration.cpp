@@ -0,0 +1,81 @@
+#include "ServoCalibration.h"
+#include "UnitState.h"
+#include "ServoDriver.h"
+#include "EEPROMMap.h"
+#include "Checksum.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#define SERVO_CAL_VERSION 1
+
+typedef struct ServoCalibrationRecord {
+  uint8_t version;
+  uint16_t pulse[2][SERVO_CAL_POINTS];
+  uint8_t crc;
+} ServoCalibrationRecord;
+
+static_assert(sizeof(ServoCalibrationRecord) <= EEPROM_SERVO_CAL_LEN, "Servo calibration does not fit its EEPROM region");
+
+namespace ServoCalibration {
+
+static UNIT_STATE uint16_t table[2][SERVO_CAL_POINTS];
+
+static bool is_increasing(const uint16_t (&t)[2][SERVO_CAL_POINTS]) {
+  for (uint8_t s = 0; s < 2; s++) {
+    for (uint8_t i = 1; i < SERVO_CAL_POINTS; i++) {
+      if (t[s][i] <= t[s][i - 1]) { return false; }
+    }
+  }
+  return true;
+}
+
+void reset() {
+  for (uint8_t s = 0; s < 2; s++) {
+    for (uint8_t i = 0; i < SERVO_CAL_POINTS; i++) {
+      table[s][i] = (SERVO_MIN_PW + (uint32_t)(SERVO_MAX_PW - SERVO_MIN_PW) * i / (SERVO_CAL_POINTS - 1)) * SERVO_TICKS_PER_US;
+    }
+  }
+}
+
+bool load() {
+  ServoCalibrationRecord rec;
+  EEPROM.get(EEPROM_SERVO_CAL_START, rec);
+  if (rec.version != SERVO_CAL_VERSION
+      || rec.crc != crc8(&rec, offsetof(ServoCalibrationRecord, crc))
+      || !is_increasing(rec.pulse)) {
+    reset();
+    return false;
+  }
+  memcpy(table, rec.pulse, sizeof(table));
+  return true;
+}
+
+bool save() {
+  if (!is_increasing(table)) { return false; }
+  ServoCalibrationRecord rec;
+  rec.version = SERVO_CAL_VERSION;
+  memcpy(rec.pulse, table, sizeof(table));
+  rec.crc = crc8(&rec, offsetof(ServoCalibrationRecord, crc));
+  EEPROM.put(EEPROM_SERVO_CAL_START, rec);
+  return true;
+}
+
+uint16_t pulse_width(uint8_t servo, int16_t angle) {
+  if (angle <= 0) { return table[servo][0]; }
+  if (angle >= SERVO_CAL_RANGE) { return table[servo][SERVO_CAL_POINTS - 1]; }
+  uint8_t idx = angle / SERVO_CAL_UNITS_PER_SEGMENT;
+  uint16_t frac = angle % SERVO_CAL_UNITS_PER_SEGMENT;
+  uint16_t lo = table[servo][idx];
+  uint16_t hi = table[servo][idx + 1];
+  return lo + (uint16_t)(((uint32_t)(hi - lo) * frac) / SERVO_CAL_UNITS_PER_SEGMENT);
+}
+
+uint16_t get_point(uint8_t servo, uint8_t idx) {
+  return table[servo][idx];
+}
+
+void set_point(uint8_t servo, uint8_t idx, uint16_t pw) {
+  table[servo][idx] = pw;
+}
+
+};
@@ -0,0 +1,56 @@
+#ifndef SERVOCALIBRATION_H
+#define SERVOCALIBRATION_H
+#include <stdint.h>
+
+// If servos are not moving from 0 to 180 degrees, then change these values.
+// They are only used to build the default table, which is replaced once the servos are calibrated.
+#define SERVO_MIN_PW 544 /** Default pulse width for -90 degrees, in microseconds */
+#define SERVO_MAX_PW 2400 /** Default pulse width for 90 degrees, in microseconds */
+
+#define SERVO_CAL_POINTS 7 /** Number of calibration points per servo, evenly spaced from -90 to 90 degrees */
+#define SERVO_CAL_UNITS_PER_SEGMENT 256 /** Resolution of the angle between two calibration points */
+#define SERVO_CAL_RANGE ((SERVO_CAL_POINTS - 1) * SERVO_CAL_UNITS_PER_SEGMENT) /** Angle units from -90 to 90 degrees */
+
+/**
+ * Piecewise-linear angle to pulse width tables for both servos, stored in EEPROM.
+ * Angles are measured in the servo's own frame, in units where 0 is -90 degrees and SERVO_CAL_RANGE is 90 degrees.
+ * Pulse widths are in ServoDriver ticks.
+ */
+namespace ServoCalibration {
+  /**
+   * @brief Loads the tables from EEPROM. If the stored tables are missing or invalid, the default linear tables are used.
+   * @return True if the tables were loaded from EEPROM.
+   */
+  bool load();
+
+  /**
+   * @brief Saves the current tables to EEPROM.
+   * @return True if successful. Tables that are not strictly increasing are not saved.
+   */
+  bool save();
+
+  /**
+   * @brief Replaces the current tables with the linear mapping from SERVO_MIN_PW to SERVO_MAX_PW. Does not save.
+   */
+  void reset();
+
+  /**
+   * @brief Interpolates the table of one servo using integer math.
+   * @param servo Servo index, 0 or 1
+   * @param angle Angle in calibration units, clamped to the range 0 to SERVO_CAL_RANGE.
+   * @return Pulse width in ServoDriver ticks
+   */
+  uint16_t pulse_width(uint8_t servo, int16_t angle);
+
+  /**
+   * @return The stored pulse width of a calibration point, in ServoDriver ticks.
+   */
+  uint16_t get_point(uint8_t servo, uint8_t idx);
+
+  /**
+   * @brief Sets the pulse width of a calibration point, in ServoDriver ticks. Does not save.
+   */
+  void set_point(uint8_t servo, uint8_t idx, uint16_t pw);
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "ServoDriver.h"
+#include "UnitState.h"
+#include <Arduino.h>
+#include <util/atomic.h>
+
+#define SERVO1_PIN 5
+#define SERVO2_PIN 6
+// Both servo pins are on port D, so the frame start can raise them with a single write
+#define SERVO1_MASK _BV(PD5)
+#define SERVO2_MASK _BV(PD6)
+
+#define FRAME_TICKS (20000 * SERVO_TICKS_PER_US) /** 20 ms servo frame */
+#define IDLE_COMPARE (FRAME_TICKS - 1) /** Compare value of a channel that has not been written yet */
+
+namespace ServoDriver {
+
+// Written by write(), latched into the compare registers by the overflow ISR once per frame
+static UNIT_STATE volatile uint16_t pending_pw1 = 0;
+static UNIT_STATE volatile uint16_t pending_pw2 = 0;
+// Last values passed to write(), only used by the main loop to skip redundant updates
+static UNIT_STATE uint16_t last_pw1 = 0;
+static UNIT_STATE uint16_t last_pw2 = 0;
+
+void attach() {
+  pinMode(SERVO1_PIN, OUTPUT);
+  pinMode(SERVO2_PIN, OUTPUT);
+  PORTD &= ~(SERVO1_MASK | SERVO2_MASK);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    // Fast PWM with ICR1 as TOP (mode 14), output compare pins disconnected so pins 9 and 10 are untouched.
+    TCCR1A = _BV(WGM11);
+    TCCR1B = _BV(WGM13) | _BV(WGM12);
+    ICR1 = FRAME_TICKS - 1;
+    OCR1A = IDLE_COMPARE;
+    OCR1B = IDLE_COMPARE;
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1) | _BV(OCF1A) | _BV(OCF1B);
+    TIMSK1 = _BV(TOIE1) | _BV(OCIE1A) | _BV(OCIE1B);
+    TCCR1B |= _BV(CS11);  // Prescaler 8 -> 2 MHz
+  }
+}
+
+void write(uint16_t pw1, uint16_t pw2) {
+  if (pw1 == last_pw1 && pw2 == last_pw2) { return; }
+  last_pw1 = pw1;
+  last_pw2 = pw2;
+  pw1 = constrain(pw1, SERVO_MIN_PULSE_TICKS, SERVO_MAX_PULSE_TICKS);
+  pw2 = constrain(pw2, SERVO_MIN_PULSE_TICKS, SERVO_MAX_PULSE_TICKS);
+  // Both values must be seen by the same frame, so the ISR cannot run between these writes
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    pending_pw1 = pw1;
+    pending_pw2 = pw2;
+  }
+}
+
+};
+
+// Start of frame: raise both pins, then queue the latest pulse widths.
+// In fast PWM the compare registers are double buffered by hardware. The pair queued by the previous
+// frame has just been latched, so reading OCR1x here returns the values this frame will end on, and
+// the values written here take effect together at the start of the next frame.
+ISR(TIMER1_OVF_vect) {
+  uint8_t mask = 0;
+  if (OCR1A != IDLE_COMPARE) mask |= SERVO1_MASK;
+  if (OCR1B != IDLE_COMPARE) mask |= SERVO2_MASK;
+  PORTD |= mask;
+  if (ServoDriver::pending_pw1 != 0) {
+    OCR1A = ServoDriver::pending_pw1;
+    OCR1B = ServoDriver::pending_pw2;
+  }
+}
+
+// End of each pulse
+ISR(TIMER1_COMPA_vect) {
+  PORTD &= ~SERVO1_MASK;
+}
+
+ISR(TIMER1_COMPB_vect) {
+  PORTD &= ~SERVO2_MASK;
+}
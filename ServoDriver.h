@@ -0,0 +1,27 @@
+#ifndef SERVODRIVER_H
+#define SERVODRIVER_H
+#include <stdint.h>
+
+#define SERVO_TICKS_PER_US 2 /** Timer1 runs at 2 MHz, so each compare tick is 0.5 microseconds */
+#define SERVO_MIN_PULSE_TICKS (400 * SERVO_TICKS_PER_US) /** Shortest pulse that will be sent, protects servos from bad values */
+#define SERVO_MAX_PULSE_TICKS (2600 * SERVO_TICKS_PER_US) /** Longest pulse that will be sent */
+
+namespace ServoDriver {
+  /**
+   * @brief Takes over Timer1 and starts the 50 Hz servo frame.
+   * @note Channel 1 pin: 5, Channel 2 pin: 6. Pins stay low until the first call to write.
+   * @note Timer1 is no longer available for the Servo library or analogWrite on pins 9 and 10.
+   */
+  void attach();
+
+  /**
+   * @brief Sets the pulse widths of both channels, in ticks of 0.5 microseconds.
+   * Both values are applied together at the start of the next frame. Writing the same values again does nothing.
+   * Pulse widths outside SERVO_MIN_PULSE_TICKS to SERVO_MAX_PULSE_TICKS are clamped to that range.
+   * @param pw1 Pulse width for channel 1 (pin 5)
+   * @param pw2 Pulse width for channel 2 (pin 6)
+   */
+  void write(uint16_t pw1, uint16_t pw2);
+};
+
+#endif
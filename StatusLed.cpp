@@ -0,0 +1,114 @@
+#include "StatusLed.h"
+#include "UnitState.h"
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+// Pin 10 is PB2. The ISR writes the port directly, which is safe because the main loop only changes port B with digitalWrite.
+#define STATUS_LED_MASK _BV(PB2)
+#define LED_PATTERN_STEPS 4 /** Most on and off durations a pattern can have */
+#define PATTERN_COMPARE 0x80 /** Timer0 compare A value, halfway between millis() overflows */
+
+namespace StatusLed {
+
+// Durations in LED_UNIT_MS, alternating on and off and starting with on. A 0 ends the pattern early.
+static const uint8_t patterns[NUM_LED_PATTERNS][LED_PATTERN_STEPS] PROGMEM = {
+  {1, 1},    // LED_PATTERN_SELECT
+  {6, 6},    // LED_PATTERN_COUNT
+  {5, 5},    // LED_PATTERN_QUICK
+  {20, 20},  // LED_PATTERN_SLOW
+  {5, 5},    // LED_PATTERN_POINT
+};
+
+// Written by play() and read by the ISR
+static UNIT_STATE volatile uint8_t queue_pattern[LED_QUEUE_SIZE];
+static UNIT_STATE volatile uint8_t queue_repeats[LED_QUEUE_SIZE];
+static UNIT_STATE volatile uint8_t queue_head = 0;
+static UNIT_STATE volatile uint8_t queued = 0;
+static UNIT_STATE volatile bool base_on = false;
+static UNIT_STATE volatile bool playing = false;
+// Only used by the ISR
+static UNIT_STATE uint8_t pattern = 0;
+static UNIT_STATE uint8_t step = 0;
+static UNIT_STATE uint8_t repeats = 0;
+static UNIT_STATE uint16_t ms_left = 0;
+static UNIT_STATE bool lit = false;
+
+static inline uint8_t step_units() {
+  return step < LED_PATTERN_STEPS ? pgm_read_byte(&patterns[pattern][step]) : 0;
+}
+
+static inline void write_led(bool on) {
+  if (on == lit) { return; }
+  lit = on;
+  if (on) {
+    PORTB |= STATUS_LED_MASK;
+  } else {
+    PORTB &= ~STATUS_LED_MASK;
+  }
+}
+
+// Called about once per ms. Counts down the current step, then moves to the next step, repeat or queued pattern.
+static inline void tick() {
+  if (ms_left > 0 && --ms_left > 0) { return; }
+  if (playing) {
+    step++;
+    if (step_units() == 0) {
+      // End of one play of the pattern. One that repeats forever gives way to the next queued pattern.
+      step = 0;
+      if (repeats == 0 ? queued > 0 : --repeats == 0) { playing = false; }
+    }
+  }
+  if (!playing && queued > 0) {
+    pattern = queue_pattern[queue_head];
+    repeats = queue_repeats[queue_head];
+    queue_head = (queue_head + 1) % LED_QUEUE_SIZE;
+    queued--;
+    step = 0;
+    playing = true;
+  }
+  if (playing) {
+    ms_left = step_units() * LED_UNIT_MS;
+    write_led(step % 2 == 0);
+  } else {
+    write_led(base_on);
+  }
+}
+
+void begin() {
+  pinMode(STATUS_LED_PIN, OUTPUT);
+  PORTB &= ~STATUS_LED_MASK;
+  // Timer0 keeps running as set up by the core for millis(). Compare A only raises an interrupt,
+  // its output pin (6) stays disconnected since it is not used with analogWrite.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    OCR0A = PATTERN_COMPARE;
+    TIMSK0 |= _BV(OCIE0A);
+  }
+}
+
+bool play(uint8_t pattern, uint8_t repeats) {
+  if (pattern >= NUM_LED_PATTERNS) { return false; }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (queued >= LED_QUEUE_SIZE) { return false; }
+    uint8_t idx = (queue_head + queued) % LED_QUEUE_SIZE;
+    queue_pattern[idx] = pattern;
+    queue_repeats[idx] = repeats;
+    queued++;
+  }
+  return true;
+}
+
+void set(bool on) {
+  base_on = on;
+}
+
+bool busy() {
+  return playing || queued > 0;
+}
+
+};
+
+// Once per Timer0 overflow period, 1.024 ms at 16 MHz, so patterns run about 2% slower than LED_UNIT_MS suggests
+ISR(TIMER0_COMPA_vect) {
+  StatusLed::tick();
+}
@@ -0,0 +1,48 @@
+#ifndef STATUSLED_H
+#define STATUSLED_H
+#include <stdint.h>
+
+#define STATUS_LED_PIN 10 /** Output pin for the status LED */
+#define LED_UNIT_MS 25 /** Pattern step durations are in units of this many ms */
+#define LED_QUEUE_SIZE 4 /** Patterns that can wait behind the one playing. More are dropped. */
+
+// Patterns, indexes into the pattern table
+#define LED_PATTERN_SELECT 0 /** Single 25 ms flash: the profile choice changed */
+#define LED_PATTERN_COUNT 1 /** 150 ms on, 150 ms off: played once per count, such as the bank number */
+#define LED_PATTERN_QUICK 2 /** 125 ms on, 125 ms off: the profiles were reset */
+#define LED_PATTERN_SLOW 3 /** 500 ms on, 500 ms off: low power */
+#define LED_PATTERN_POINT 4 /** Single 125 ms flash: a servo calibration point was set */
+#define NUM_LED_PATTERNS 5
+
+/**
+ * Plays LED patterns from a table in the background, so modes never wait for the LED.
+ * Patterns are queued and played in order by the Timer0 compare A interrupt, which fires about once per ms
+ * alongside the millis() overflow interrupt. Timer0's counter and prescaler are left untouched.
+ * While no pattern is playing, the LED shows the level given to set().
+ */
+namespace StatusLed {
+  /**
+   * @brief Sets up the LED pin and starts the pattern interrupt. Call once at startup.
+   */
+  void begin();
+
+  /**
+   * @brief Queues a pattern behind any that are playing or waiting. Never waits.
+   * @param pattern LED_PATTERN_* to play
+   * @param repeats Times to play the pattern. 0 repeats it until another pattern is queued.
+   * @return True if queued, false if the queue was full.
+   */
+  bool play(uint8_t pattern, uint8_t repeats);
+
+  /**
+   * @brief Sets the level the LED shows while no pattern is playing, such as a contact indicator.
+   */
+  void set(bool on);
+
+  /**
+   * @return True while a pattern is playing or queued.
+   */
+  bool busy();
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef UNIT_STATE_H
+#define UNIT_STATE_H
+
+/**
+ * Storage of all state that belongs to one feeder: every global and static variable that is not constant is declared with it.
+ * A board runs one unit, so on the AVR this is plain static storage. A host build running many simulated units on threads
+ * defines it as thread_local, so each thread is a unit with its own copy of the state.
+ */
+#ifndef UNIT_STATE
+#define UNIT_STATE
+#endif
+
+#endif
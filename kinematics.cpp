@@ -9,36 +9,93 @@ static float dist_sq(float x1, float y1, float x2, float y2) {
 
 static bool twoLinkIK(float x, float y, float a, float b, bool elbowup, float &t1, float &t2) {
   float D = (x * x + y * y - a * a - b * b) / (2.0 * a * b);
-  if (D > 1.0) {
+  if (!(fabs(D) <= 1.0 + 1e-4)) {  // Also rejects NaN
     return false;
   }
+  if (D > 1.0) {
+    D = 1.0;  // Points on the edge of the workspace can land just outside it by rounding
+  } else if (D < -1.0) {
+    D = -1.0;
+  }
   t2 = atan2((elbowup ? 1.0 : -1.0) * sqrt(1.0 - D * D), D);
   t1 = atan2(y, x) - atan2(b * sin(t2), a + b * cos(t2));
   return true;
 }
 
+/**
+ * Wraps an angle into the servo range if a turn of 2 PI gets it there, and clamps it if it is just outside from rounding.
+ * @param clamped Increased by how far the angle was clamped
+ * @return True if the angle is within the range.
+ */
+static bool fit_range(float &q, float lo, float hi, float &clamped) {
+  if (q < lo - Q_LIMIT_TOLERANCE) q += 2 * M_PI;
+  else if (q > hi + Q_LIMIT_TOLERANCE) q -= 2 * M_PI;
+  if (q < lo - Q_LIMIT_TOLERANCE || q > hi + Q_LIMIT_TOLERANCE) { return false; }
+  float fitted = q < lo ? lo : (q > hi ? hi : q);
+  clamped += fabs(fitted - q);
+  q = fitted;
+  return true;
+}
+
+uint8_t solve_ik(float x, float y, float q1_cur, float q2_cur, float &q1_ptr, float &q2_ptr) {
+  float best_q1 = 0, best_q2 = 0, best_dist = INFINITY;
+  for (uint8_t branch = 0; branch < 2; branch++) {
+    float t1, t2;
+    if (!twoLinkIK(x, y, L1, L2, branch == 0, t1, t2)) { return IK_UNREACHABLE; }
+    float clamped = 0;
+    if (!fit_range(t1, Q1_MIN, Q1_MAX, clamped) || !fit_range(t2, Q2_MIN, Q2_MAX, clamped)) { continue; }
+    // Near the singularity the branches are equally near, so prefer the exact one over one clamped into range
+    float dist = fabs(t1 - q1_cur) + fabs(t2 - q2_cur) + 1000 * clamped;
+    if (dist < best_dist) {
+      best_dist = dist;
+      best_q1 = t1;
+      best_q2 = t2;
+    }
+  }
+  if (best_dist == INFINITY) { return IK_JOINT_LIMIT; }
+  q1_ptr = best_q1;
+  q2_ptr = best_q2;
+  return IK_OK;
+}
+
 bool calc_ik(float x, float y, float &q1_ptr, float &q2_ptr) {
-  return twoLinkIK(x, y, L1, L2, true, q1_ptr, q2_ptr);
+  return solve_ik(x, y, (Q1_MIN + Q1_MAX) / 2, (Q2_MIN + Q2_MAX) / 2, q1_ptr, q2_ptr) == IK_OK;
 }
 
 bool calc_fk(float q1, float q2, float &x_ptr, float &y_ptr) {
   x_ptr = L1*cos(q1) + L2*cos(q1+q2);
   y_ptr = L1*sin(q1) + L2*sin(q1+q2);
+  return isfinite(x_ptr) && isfinite(y_ptr);
 }
 
 bool constrain_ik_point(float &x, float &y) {
   bool modified = false;
-  if (isnan(x) || isnan(y)) {
+  if (!isfinite(x) || !isfinite(y)) {
     x = 0.0;
     y = -100.0;
     return true;
   }
+  // The half-plane and x limits go first, because the reach limits below never undo them
+  if (y > -0.001) {
+    y = -0.001;
+    modified = true;
+  }
+  const float min_x = -0.9 * (L1 + L2);
+  if (x < min_x) {
+    x = min_x;
+    modified = true;
+  }
   const float max_mag = L1+L2;
   const float min_mag = 10;
   float mag = sqrt(x * x + y * y);
   if (mag > max_mag) {
     x *= max_mag / mag;
     y *= max_mag / mag;
+    // Scaling in lifts points near the half-plane limit above it, so slide along the reach circle back below it
+    if (y > -0.001) {
+      y = -0.001;
+      x = copysign(sqrt(max_mag * max_mag - y * y), x);
+    }
     modified = true;
   } else if(mag < min_mag) {
     x *= min_mag / mag;
@@ -50,15 +107,15 @@ bool constrain_ik_point(float &x, float &y) {
   if (mag < L1) {
     x = (x + L1) * L1 / mag - L1;
     y = (y)*L1 / mag;
-    modified = true;
-  }
-  if (y > -0.001) {
-    y = -0.001;
-    modified = true;
-  }
-  if (x < -0.9 * (L1 + L2)) {
-    x = -0.9 * (L1 + L2);
+    // The boundary circle leaves the other limits at its ends, so slide along it back inside them
+    if (x < min_x) {
+      x = min_x;
+      y = -sqrt(L1 * L1 - (x + L1) * (x + L1));
+    } else if (x * x + y * y < min_mag * min_mag) {
+      x = -min_mag * min_mag / (2 * L1);
+      y = -sqrt(min_mag * min_mag - x * x);
+    }
     modified = true;
   }
   return modified;
-}
\ No newline at end of file
+}
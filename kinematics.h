@@ -1,28 +1,51 @@
 #ifndef KINEMATICS_H
 #define KINEMATICS_H
+#include <stdint.h>
 
 #define Q1_HOME -3.1415926
 #define Q2_HOME 2.1817
 #define HOME_X -42.6424
 #define HOME_Y -81.9152
 
+#define Q1_MIN -3.1415926 /** Servo 1 range, as assumed by write_servos */
+#define Q1_MAX 0.0
+#define Q2_MIN 0.0 /** Servo 2 range, as assumed by write_servos */
+#define Q2_MAX 3.1415926
+#define Q_LIMIT_TOLERANCE 0.001 /** Solutions this close outside a servo range are clamped into it, to allow for rounding */
+
+// Results of solve_ik
+#define IK_OK 0
+#define IK_UNREACHABLE 1 /** The point is out of reach of the arm, or not finite */
+#define IK_JOINT_LIMIT 2 /** The point is in reach, but neither elbow branch keeps both joints in their servo ranges */
+
 extern const float L1;
 extern const float L2;
 
 /**
  * @brief Calculates forward kinematics for given joint values.
- * @return True if the kinematic calculation was successful. If so, writes end effector position to x_ptr and y_ptr.
+ * @return True if the resulting end effector position is finite. The position is always written to x_ptr and y_ptr.
  */
 bool calc_fk(float q1, float q2, float &x_ptr, float &y_ptr);
 
 /**
  * @brief Calculates inverse kinematics for a given point relative to the robot's origin (the shoulder joint).
+ * Uses the solution within the servo ranges nearest the middle of both ranges. Prefer solve_ik when the current pose is known.
  * @return True if the kinematic calculation was successful. If so, writes joint values to q1_ptr and q2_ptr.
  */
 bool calc_ik(float x, float y, float &q1_ptr, float &q2_ptr);
 
 /**
- * @brief Constrains an ik point to be within workspace bounds.
+ * @brief Solves inverse kinematics for both elbow branches, and picks the one within the servo ranges nearest the current pose.
+ * Both branches meet at full extension, so picking the nearest one keeps the joints continuous through that singularity.
+ * @param q1_cur Current q1, used to choose between branches
+ * @param q2_cur Current q2, used to choose between branches
+ * @return IK_OK if joint values were written to q1_ptr and q2_ptr, otherwise IK_UNREACHABLE or IK_JOINT_LIMIT and they are left unchanged.
+ */
+uint8_t solve_ik(float x, float y, float q1_cur, float q2_cur, float &q1_ptr, float &q2_ptr);
+
+/**
+ * @brief Constrains an ik point to be within workspace bounds: below the shoulder, within reach, and reachable with q1 in -PI to 0.
+ * Constraining a point that is already constrained leaves it unchanged. Non-finite points are replaced with a point below the shoulder.
  * @return True if the point was modified.
  */
 bool constrain_ik_point(float &x, float &y);
@@ -0,0 +1,62 @@
+#include "Bench.h"
+#include <stddef.h>
+#include <string.h>
+#include "firmware.h"
+
+void Bench::power_up() {
+  host_reset(board);
+  host_board = &board;
+  board.device = &plant;
+  board.analog[BENCH_POT_PIN] = SELECTOR_FIRST_CENTER;
+  memset(mode_visits, 0, sizeof(mode_visits));
+  plant.step(board);  // The sense inputs read the plant from power on
+  setup();
+  mode_visits[cur_mode_id]++;
+}
+
+void Bench::step() {
+  uint8_t before = cur_mode_id;
+  host_advance(BENCH_LOOP_US);
+  loop();
+  if (cur_mode_id != before && cur_mode_id < sizeof(mode_visits)) mode_visits[cur_mode_id]++;
+}
+
+void Bench::run(unsigned long ms) {
+  unsigned long end = board.now_us + ms * 1000;
+  while (board.now_us < end) {
+    step();
+  }
+}
+
+bool Bench::run_until(Mode mode, unsigned long timeout_ms) {
+  unsigned long end = board.now_us + timeout_ms * 1000;
+  while (!in_mode(mode)) {
+    if (board.now_us >= end) { return false; }
+    step();
+  }
+  return true;
+}
+
+void Bench::press_input(unsigned long ms) {
+  board.pin_level[BENCH_INPUT_PIN] = 0;  // The switch pulls the input low
+  run(ms);
+  board.pin_level[BENCH_INPUT_PIN] = 1;
+}
+
+bool Bench::in_mode(Mode mode) const {
+  return cur_mode_id == mode_id(mode);
+}
+
+uint8_t Bench::visits(Mode mode) const {
+  uint8_t id = mode_id(mode);
+  return id < sizeof(mode_visits) ? mode_visits[id] : 0;
+}
+
+bool Bench::logged(uint8_t type) const {
+  for (uint8_t i = 0; i < EVENT_LOG_ENTRIES; i++) {
+    EventRecord rec;
+    memcpy(&rec, board.eeprom + EEPROM_EVENT_LOG_START + 1 + sizeof(EventRecord) * i, sizeof(EventRecord));
+    if (rec.crc == crc8(&rec, offsetof(EventRecord, crc)) && rec.type == type) { return true; }
+  }
+  return false;
+}
@@ -0,0 +1,81 @@
+#ifndef BENCH_H
+#define BENCH_H
+// The whole sketch running on a host board, with the arm modeled by a Plant, and a user pressing its buttons.
+#include "HostBoard.h"
+#include "Plant.h"
+#include "UnitState.h"
+
+#define BENCH_LOOP_US 1000 /** Time each pass of loop() spends computing, on top of the time its calls to the core take */
+#define BENCH_INPUT_PIN 2 /** INPUT_PIN of the sketch */
+#define BENCH_BUTTON_PIN 7 /** JOYSTICK_BUTTON_PIN of Joystick */
+#define BENCH_POT_PIN 5 /** PROFILE_POT_PIN of ProfileSelector, as an analog channel */
+
+typedef void (*Mode)();
+
+/**
+ * A board running the sketch, wired to a plant. The sketch has one copy of its state per thread, so each thread runs one bench at
+ * a time, and the state is only as after a reset on a thread that has not run the sketch before.
+ */
+struct Bench {
+  HostBoard board;
+  Plant plant;
+  uint8_t mode_visits[32];  // Times each mode id has been entered
+
+  /**
+   * @brief Powers the board up with erased EEPROM, the profile potentiometer on the first profile, and runs setup().
+   */
+  void power_up();
+
+  /**
+   * @brief Runs one pass of loop().
+   */
+  void step();
+
+  /**
+   * @brief Runs loop() until a time has passed.
+   */
+  void run(unsigned long ms);
+
+  /**
+   * @brief Runs loop() until the sketch enters a mode.
+   * @return False if it did not within timeout_ms.
+   */
+  bool run_until(Mode mode, unsigned long timeout_ms);
+
+  /**
+   * @brief Holds the input switch down for a time while the sketch runs, then releases it.
+   */
+  void press_input(unsigned long ms);
+
+  /**
+   * @return True if the sketch is in a mode
+   */
+  bool in_mode(Mode mode) const;
+
+  /**
+   * @return Times a mode has been entered since power up
+   */
+  uint8_t visits(Mode mode) const;
+
+  /**
+   * @return True if the event log in EEPROM holds an event of a type
+   */
+  bool logged(uint8_t type) const;
+};
+
+// The sketch's own functions and state, for benches and tests to drive and inspect it
+void setup();
+void loop();
+uint8_t mode_id(Mode mode);
+extern UNIT_STATE uint8_t cur_mode_id;
+void move_home_then_wait();
+void wait_mode();
+void descend_step();
+void scoop_step();
+void lift_step_fk();
+void feed_wait_step();
+void return_step();
+void cancel_scoop_up_step();
+void low_power_mode();
+
+#endif
@@ -0,0 +1,84 @@
+#include "Plant.h"
+#include <math.h>
+#include <avr/io.h>
+#include "firmware.h"
+
+#define SERVO_POWER_PIN 3 /** SERVO_POWER_PWM of the sketch */
+#define MOTOR_PWM_PIN 11 /** DC_PWM_PIN of DCMotor */
+#define MAX_STEP_TIME 50000 /** Longest step in us. Long gaps are clamped so the model does not jump. */
+#define NO_PULSE (HOST_TIMER1_PERIOD_US * SERVO_TICKS_PER_US - 1) /** Compare value of a ServoDriver channel that has no pulse yet */
+
+Plant::Plant()
+    : servo_tau(PLANT_SERVO_TAU), servo_max_speed(PLANT_SERVO_MAX_SPEED),
+      idle_current(PLANT_IDLE_CURRENT), speed_current(PLANT_SPEED_CURRENT), load_current(PLANT_LOAD_CURRENT),
+      contact_current(PLANT_CONTACT_CURRENT), bowl_bottom_y(PLANT_BOWL_BOTTOM_Y), bowl_center_x(PLANT_BOWL_CENTER_X),
+      bowl_half_width(PLANT_BOWL_HALF_WIDTH), bowl_wall_slope(PLANT_BOWL_WALL_SLOPE), bowl_rim_y(PLANT_BOWL_RIM_Y),
+      motor_full_current(PLANT_MOTOR_CURRENT),
+      supply_voltage(PLANT_SUPPLY_VOLTAGE), supply_sag(PLANT_SUPPLY_SAG),
+      q1(Q1_HOME), q2(Q2_HOME), speed_sum(0), time_us(0), max_depth(0), max_current(0) {}
+
+/**
+ * Finds the servo angle a pulse width commands, in calibration units, by searching the calibration table.
+ */
+static int16_t servo_angle(uint8_t servo, uint16_t pw) {
+  int16_t lo = 0, hi = SERVO_CAL_RANGE;
+  while (lo < hi) {
+    int16_t mid = (lo + hi) / 2;
+    if (ServoCalibration::pulse_width(servo, mid) < pw) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/**
+ * Moves one joint towards its command with a first-order lag, limited to the servo speed.
+ * @return Joint speed in rad/s
+ */
+static float step_joint(float &pos, float cmd, float dt, float tau, float max_speed) {
+  float speed = fmax(fmin((cmd - pos) / tau, max_speed), -max_speed);
+  if (fabs(speed * dt) > fabs(cmd - pos)) {
+    pos = cmd;
+  } else {
+    pos += speed * dt;
+  }
+  return fabs(speed);
+}
+
+float Plant::contact_depth() const {
+  float x, y;
+  calc_fk(q1, q2, x, y);
+  float surface = bowl_bottom_y;
+  float from_center = fabs(x - bowl_center_x);
+  if (from_center > bowl_half_width) surface += (from_center - bowl_half_width) * bowl_wall_slope;
+  if (surface > bowl_rim_y) { return 0; }  // Outside the bowl
+  return fmax(surface - y, 0.0);
+}
+
+void Plant::step(HostBoard &board) {
+  float dt = fmin(board.now_us - time_us, MAX_STEP_TIME) * 1e-6;
+  time_us = board.now_us;
+  bool powered = board.pin_level[SERVO_POWER_PIN];
+  speed_sum = 0;
+  // The servos follow the pulse widths of the current frame, which ServoDriver latched into the compare registers
+  if (powered && OCR1A != NO_PULSE && OCR1B != NO_PULSE) {
+    const float rad_per_unit = M_PI / SERVO_CAL_RANGE;
+    float cmd_q1 = -servo_angle(0, OCR1A) * rad_per_unit;
+    float cmd_q2 = M_PI - servo_angle(1, OCR1B) * rad_per_unit;
+    speed_sum = step_joint(q1, cmd_q1, dt, servo_tau, servo_max_speed) + step_joint(q2, cmd_q2, dt, servo_tau, servo_max_speed);
+  }
+  float depth = contact_depth();
+  max_depth = fmax(max_depth, depth);
+  float servo = 0;
+  if (powered) {
+    float reach = fabs(L1 * cos(q1) + L2 * cos(q1 + q2)) / (L1 + L2);
+    servo = fmin(idle_current + speed_current * speed_sum + load_current * reach + contact_current * depth, 1023);
+  }
+  float motor = motor_full_current * board.pwm[MOTOR_PWM_PIN] / 255;
+  board.analog[SERVO_CURRENT_PIN] = servo;
+  board.analog[MOTOR_CURRENT_PIN] = motor;
+  board.analog[SERVO_VOLTAGE_PIN] = fmax(supply_voltage - supply_sag * (servo + motor), 0);
+  max_current = fmax(max_current, board.analog[SERVO_CURRENT_PIN]);
+}
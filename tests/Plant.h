@@ -0,0 +1,53 @@
+#ifndef PLANT_H
+#define PLANT_H
+// A model of the arm, for running the sketch without servos or food. It replaces the current and voltage sense readings, so the
+// scooping thresholds and overload handling behave as they would on the arm.
+#include "HostBoard.h"
+
+// Servo dynamics
+#define PLANT_SERVO_TAU 0.05 /** Time constant of the servos' first-order response to a new angle, in seconds */
+#define PLANT_SERVO_MAX_SPEED 6.0 /** Speed limit of the servos, in rad/s */
+// Servo current, in analogRead units (337.6 per A)
+#define PLANT_IDLE_CURRENT 80 /** Current with the arm still and unloaded */
+#define PLANT_SPEED_CURRENT 25 /** Current per rad/s of joint speed, summed over both joints */
+#define PLANT_LOAD_CURRENT 120 /** Current holding the arm straight out horizontally. Scales with the horizontal reach. */
+#define PLANT_CONTACT_CURRENT 60 /** Current per mm that the spoon is pushed into the bowl surface */
+// Bowl surface, in mm relative to the shoulder. The bottom is flat, and the walls rise from its edges.
+#define PLANT_BOWL_BOTTOM_Y -176.0 /** Height of the bowl bottom */
+#define PLANT_BOWL_CENTER_X 0.0 /** Horizontal center of the bowl */
+#define PLANT_BOWL_HALF_WIDTH 78.0 /** Distance from the center to where the walls start */
+#define PLANT_BOWL_WALL_SLOPE 3.0 /** Rise of the walls per mm outwards */
+#define PLANT_BOWL_RIM_Y -100.0 /** Height of the rim, where the walls end */
+// DC motor and supply
+#define PLANT_MOTOR_CURRENT 150 /** DC motor current at full speed, in analogRead units */
+#define PLANT_SUPPLY_VOLTAGE 757 /** Servo voltage sense with no load, in analogRead units (7.4 V battery) */
+#define PLANT_SUPPLY_SAG 0.15 /** Drop of the voltage sense per unit of servo and motor current */
+
+/**
+ * The servos follow the pulse widths ServoDriver sends, through the servo calibration tables, with lag and a speed limit.
+ * They draw current for speed, gravity load and contact with a bowl, and the supply voltage sags with it. The DC motor draws
+ * current with its PWM duty. Unpowered servos hold still and draw nothing.
+ * The parameters start at the PLANT_* defaults, and can be changed to model other arms and bowls.
+ */
+struct Plant : HostDevice {
+  float servo_tau, servo_max_speed;
+  float idle_current, speed_current, load_current, contact_current;
+  float bowl_bottom_y, bowl_center_x, bowl_half_width, bowl_wall_slope, bowl_rim_y;
+  float motor_full_current, supply_voltage, supply_sag;
+
+  float q1, q2;            // Modeled joint angles
+  float speed_sum;         // |dq1/dt| + |dq2/dt|, in rad/s
+  unsigned long time_us;   // Time of the last step
+  float max_depth;         // Deepest the spoon has been pushed into the bowl, in mm
+  uint16_t max_current;    // Highest servo current sense so far
+
+  Plant();
+  void step(HostBoard &board);
+
+  /**
+   * @return How far the spoon is pushed into the bowl surface, in mm
+   */
+  float contact_depth() const;
+};
+
+#endif
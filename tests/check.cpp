@@ -0,0 +1,67 @@
+#include "check.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_REPORTED_FAILURES 20 /** Failures printed in full, the rest are only counted */
+
+static uint32_t iterations = 0;
+static uint32_t seed = 1;
+static uint32_t state = 1;
+static uint32_t failures = 0;
+
+void check_begin(int argc, char **argv, uint32_t default_iterations) {
+  iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : default_iterations;
+  seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+  state = seed ? seed : 1;
+}
+
+uint32_t check_iterations() {
+  return iterations;
+}
+
+int check_end(const char *name) {
+  printf("%s: %s, %u iterations, seed %u, %u failures\n", name, failures ? "FAIL" : "ok", iterations, seed, failures);
+  return failures ? 1 : 0;
+}
+
+void check_isolated(const char *name, void (*checks)()) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    failures = 0;
+    checks();
+    fflush(stdout);
+    _exit(failures > 255 ? 255 : failures);
+  }
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+    failures++;
+    printf("%s: crashed or could not run\n", name);
+    return;
+  }
+  failures += WEXITSTATUS(status);
+}
+
+void check_failed(const char *file, int line, const char *cond, const char *fmt, ...) {
+  if (++failures > MAX_REPORTED_FAILURES) { return; }
+  printf("%s:%d: %s failed: ", file, line, cond);
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  printf("\n");
+}
+
+uint32_t rand_u32() {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+float rand_float(float lo, float hi) {
+  return lo + (hi - lo) * (rand_u32() >> 8) * (1.0f / (1 << 24));
+}
@@ -0,0 +1,46 @@
+#ifndef CHECK_H
+#define CHECK_H
+// Support for the property tests: failure reports, and a seeded random generator so any failure can be replayed.
+#include <stdint.h>
+
+/**
+ * Counts a failed property and prints where it failed, with a printf-style description of the case.
+ */
+#define CHECK(cond, ...) do { if (!(cond)) check_failed(__FILE__, __LINE__, #cond, __VA_ARGS__); } while (0)
+
+/**
+ * @brief Reads the optional arguments of a test: [iterations] [seed], and seeds the generator.
+ * @param default_iterations Iterations of the main property loops when none are given
+ */
+void check_begin(int argc, char **argv, uint32_t default_iterations);
+
+/**
+ * @return Iterations to run the main property loops for
+ */
+uint32_t check_iterations();
+
+/**
+ * @brief Prints a summary line.
+ * @return Exit status for main: 0 if every check passed.
+ */
+int check_end(const char *name);
+
+/**
+ * @brief Runs checks in a child process, which starts from the state the program had before any firmware ran, as after a reset.
+ * Its failures are counted here, and a crash counts as one.
+ */
+void check_isolated(const char *name, void (*checks)());
+
+void check_failed(const char *file, int line, const char *cond, const char *fmt, ...);
+
+/**
+ * @return 32 random bits (xorshift32)
+ */
+uint32_t rand_u32();
+
+/**
+ * @return A random float from lo to hi
+ */
+float rand_float(float lo, float hi);
+
+#endif
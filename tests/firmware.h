@@ -0,0 +1,20 @@
+#ifndef FIRMWARE_H
+#define FIRMWARE_H
+// Firmware headers for test code. The firmware is built with -fpack-struct, so struct layouts match avr-gcc's and the EEPROM
+// and frame formats fit. Test code is built normally, so the firmware's structs are declared packed here to match.
+#pragma pack(push, 1)
+#include "kinematics.h"
+#include "MotionPlanner.h"
+#include "Profile.h"
+#include "Checksum.h"
+#include "EEPROMMap.h"
+#include "EventLog.h"
+#include "ScoopLearning.h"
+#include "ServoCalibration.h"
+#include "ServoDriver.h"
+#include "ProfileSelector.h"
+#include "Sensors.h"
+#pragma pack(pop)
+#include "HostBoard.h"
+
+#endif
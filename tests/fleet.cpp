@@ -0,0 +1,246 @@
+// A fleet of simulated feeders serving meals in parallel, for regression testing firmware changes over many bites.
+//   build/fleet [units] [seed] [threads]
+// Each unit is the whole sketch on its own bench, with its own plate load and its own user, drawn at random from the seed. Units
+// run on a pool of threads, and the report covers every bite of every unit: how many scoops reached the user with food, why the
+// others did not, and how long the arm took from the request to the spoon at the user.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "firmware.h"
+#include "Bench.h"
+
+#define FLEET_UNITS 64 /** Units simulated when none are given */
+#define MEAL_BITES 20 /** Bites each unit serves */
+#define BITE_TIMEOUT 60000 /** ms for a scoop to reach the user or go home before the unit counts as stuck */
+#define RETURN_TIMEOUT 30000 /** ms for the arm to get back to wait_mode after a bite */
+// Plate load. Food levels are heights of the food surface in mm, as Plant::bowl_bottom_y.
+#define FOOD_LEVEL_MIN -170.0 /** Lowest food level at the start of a meal */
+#define FOOD_LEVEL_MAX -160.0 /** Highest food level at the start of a meal */
+#define FOOD_EMPTY_LEVEL -180.0 /** Food level of an empty bowl, below the bottom of the default profile */
+#define FOOD_BITE_MIN 0.1 /** Least the food level drops per bite, in mm */
+#define FOOD_BITE_MAX 0.5 /** Most the food level drops per bite, in mm */
+#define FOOD_STIFFNESS_MIN 30 /** Softest food, as Plant::contact_current */
+#define FOOD_STIFFNESS_MAX 90 /** Firmest food */
+#define SPOON_LOAD_MIN 100 /** Lightest spoon and food, as Plant::load_current */
+#define SPOON_LOAD_MAX 160 /** Heaviest spoon and food */
+#define OBSTACLE_CHANCE 2 /** Percent of bites that hit something rigid in the bowl */
+#define OBSTACLE_STIFFNESS 20000 /** Plant::contact_current of a rigid obstacle */
+// User timings, in ms
+#define USER_PRESS_MIN 80 /** Shortest press of the input switch. wait_mode ignores presses of 50 ms or less. */
+#define USER_PRESS_MAX 400 /** Longest short press. Holding for ROTATE_PLATE_TIME (500 ms) rotates the plate instead. */
+#define USER_PAUSE_MAX 8000 /** Longest wait between a bite and asking for the next */
+#define USER_CHEW_MIN 2000 /** Shortest time the user takes a bite off the spoon in */
+#define USER_CHEW_MAX 15000 /** Longest time the user takes a bite off the spoon in */
+#define USER_ROTATE_CHANCE 20 /** Percent of bites the user turns the plate before */
+#define USER_ROTATE_MIN 600 /** Shortest hold to turn the plate */
+#define USER_ROTATE_MAX 2000 /** Longest hold to turn the plate */
+
+/**
+ * What became of one request for a bite.
+ */
+enum BiteOutcome { BITE_SERVED, BITE_EMPTY, BITE_OVERLOAD, BITE_ABORTED, BITE_IGNORED, BITE_LOW_POWER, BITE_STUCK, NUM_OUTCOMES };
+static const char *const OUTCOME_NAMES[NUM_OUTCOMES] = {
+  "served", "empty spoon", "overload, went home", "aborted, returned", "request ignored", "low power, stopped", "stuck",
+};
+
+/**
+ * One feeder, its plate and its user, and what happened over its meal. All of its firmware state is in the UNIT_STATE variables
+ * of the thread that runs it, so run() must be called on a thread that has not run the sketch before.
+ */
+struct Unit {
+  uint32_t rng;
+  // Plate load
+  float food_level, food_stiffness, spoon_load;
+  // User timings, in ms: each unit's user has their own pace, and every bite varies within it
+  uint16_t press_ms, pause_ms, chew_ms;
+  // Results
+  uint16_t outcomes[NUM_OUTCOMES];
+  uint16_t obstacle_stops;        // Bites that hit an obstacle and ended in low power instead of the overload going home
+  std::vector<float> bite_times;  // Seconds from each request to the spoon at the user, for bites that got there
+
+  Unit(uint32_t seed);
+  void run();
+  uint32_t rand_u32();
+  float rand_float(float lo, float hi);
+  unsigned long user_ms(unsigned long typical);
+  unsigned long user_press();
+
+  /**
+   * @brief Asks for one bite and waits for it, then eats it and sends the arm back.
+   * @return False if the unit stopped or got stuck, which ends its meal.
+   */
+  bool bite(Bench &bench);
+};
+
+Unit::Unit(uint32_t seed) : rng(seed ? seed : 1), obstacle_stops(0), bite_times() {
+  for (uint8_t i = 0; i < 4; i++) rand_u32();  // Nearby seeds give unrelated units
+  food_level = rand_float(FOOD_LEVEL_MIN, FOOD_LEVEL_MAX);
+  food_stiffness = rand_float(FOOD_STIFFNESS_MIN, FOOD_STIFFNESS_MAX);
+  spoon_load = rand_float(SPOON_LOAD_MIN, SPOON_LOAD_MAX);
+  press_ms = rand_float(USER_PRESS_MIN, USER_PRESS_MAX);
+  pause_ms = rand_float(0, USER_PAUSE_MAX);
+  chew_ms = rand_float(USER_CHEW_MIN, USER_CHEW_MAX);
+  memset(outcomes, 0, sizeof(outcomes));
+}
+
+// xorshift32 like check.cpp, but one generator per unit so threads do not share one
+uint32_t Unit::rand_u32() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+float Unit::rand_float(float lo, float hi) {
+  return lo + (hi - lo) * (rand_u32() >> 8) * (1.0f / (1 << 24));
+}
+
+/**
+ * @return A time around a user's typical one, from half of it to one and a half times it
+ */
+unsigned long Unit::user_ms(unsigned long typical) {
+  return typical * rand_float(0.5, 1.5);
+}
+
+/**
+ * @return A short press, around the user's typical one
+ */
+unsigned long Unit::user_press() {
+  return std::min(std::max(user_ms(press_ms), (unsigned long)USER_PRESS_MIN), (unsigned long)USER_PRESS_MAX);
+}
+
+bool Unit::bite(Bench &bench) {
+  bench.run(user_ms(pause_ms));
+  if (rand_u32() % 100 < USER_ROTATE_CHANCE) {
+    bench.press_input(rand_float(USER_ROTATE_MIN, USER_ROTATE_MAX));
+    if (!bench.run_until(wait_mode, RETURN_TIMEOUT)) {
+      outcomes[BITE_STUCK]++;
+      return false;
+    }
+  }
+  bool obstacle = rand_u32() % 100 < OBSTACLE_CHANCE;
+  bench.plant.bowl_bottom_y = food_level;
+  bench.plant.contact_current = obstacle ? OBSTACLE_STIFFNESS : food_stiffness;
+  bench.plant.max_depth = 0;
+  uint8_t descents = bench.visits(descend_step), returns = bench.visits(return_step);
+  unsigned long start = bench.board.now_us;
+  bench.press_input(user_press());
+  bench.run(10);  // wait_mode leaves on the pass that sees the release
+  if (bench.visits(descend_step) == descents) {
+    outcomes[BITE_IGNORED]++;
+    return true;
+  }
+  unsigned long end = bench.board.now_us + BITE_TIMEOUT * 1000UL;
+  while (!bench.in_mode(feed_wait_step) && !bench.in_mode(wait_mode) && bench.board.now_us < end) {
+    bench.step();
+  }
+  if (bench.in_mode(wait_mode)) {
+    outcomes[bench.visits(return_step) != returns ? BITE_ABORTED : BITE_OVERLOAD]++;
+    return true;
+  }
+  if (!bench.in_mode(feed_wait_step)) {
+    bool stopped = bench.in_mode(low_power_mode);
+    outcomes[stopped ? BITE_LOW_POWER : BITE_STUCK]++;
+    if (stopped && obstacle) obstacle_stops++;
+    return false;
+  }
+  bite_times.push_back((bench.board.now_us - start) * 1e-6);
+  if (bench.plant.max_depth > 0) {
+    outcomes[BITE_SERVED]++;
+    food_level = std::max(food_level - rand_float(FOOD_BITE_MIN, FOOD_BITE_MAX), (float)FOOD_EMPTY_LEVEL);
+  } else {
+    outcomes[BITE_EMPTY]++;
+  }
+  bench.run(user_ms(chew_ms));
+  bench.press_input(user_press());
+  if (!bench.run_until(wait_mode, RETURN_TIMEOUT)) {
+    outcomes[BITE_STUCK]++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Powers the unit up, sends the arm home from the user, where it starts, and serves a meal.
+ */
+void Unit::run() {
+  Bench bench;
+  bench.plant.load_current = spoon_load;
+  bench.power_up();
+  bool started = bench.run_until(feed_wait_step, BITE_TIMEOUT);
+  if (started) {
+    bench.press_input(USER_PRESS_MIN);
+    started = bench.run_until(wait_mode, RETURN_TIMEOUT);
+  }
+  if (!started) {
+    outcomes[BITE_STUCK]++;
+    return;
+  }
+  for (uint8_t i = 0; i < MEAL_BITES && bite(bench); i++) {}
+}
+
+/**
+ * Runs every unit. Each worker of the pool runs its units one at a time, each on a new thread, so every unit starts from firmware
+ * state as after a reset.
+ */
+static void run_fleet(std::vector<Unit> &units, unsigned threads) {
+  std::atomic<unsigned> next(0);
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.push_back(std::thread([&units, &next]() {
+      for (unsigned i = next++; i < units.size(); i = next++) {
+        std::thread(&Unit::run, &units[i]).join();
+      }
+    }));
+  }
+  for (size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+}
+
+static float percentile(const std::vector<float> &sorted, float p) {
+  return sorted[lround(p * (sorted.size() - 1))];
+}
+
+int main(int argc, char **argv) {
+  unsigned num_units = argc > 1 ? strtoul(argv[1], NULL, 0) : FLEET_UNITS;
+  uint32_t seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+  unsigned threads = argc > 3 ? strtoul(argv[3], NULL, 0) : std::thread::hardware_concurrency();
+  threads = std::max(std::min(threads, num_units), 1u);
+
+  std::vector<Unit> units;
+  for (unsigned i = 0; i < num_units; i++) {
+    units.push_back(Unit(seed * 2654435761u + i));
+  }
+  run_fleet(units, threads);
+
+  uint32_t totals[NUM_OUTCOMES] = {0};
+  uint32_t bites = 0, obstacle_stops = 0;
+  std::vector<float> times;
+  for (size_t i = 0; i < units.size(); i++) {
+    for (uint8_t o = 0; o < NUM_OUTCOMES; o++) {
+      totals[o] += units[i].outcomes[o];
+      bites += units[i].outcomes[o];
+    }
+    times.insert(times.end(), units[i].bite_times.begin(), units[i].bite_times.end());
+    obstacle_stops += units[i].obstacle_stops;
+  }
+  printf("fleet: %u units, %u bites each, seed %u, %u threads\n", num_units, MEAL_BITES, seed, threads);
+  for (uint8_t o = 0; o < NUM_OUTCOMES; o++) {
+    printf("  %-20s %6u  %5.1f%%\n", OUTCOME_NAMES[o], totals[o], bites ? 100.0 * totals[o] / bites : 0.0);
+  }
+  if (!times.empty()) {
+    std::sort(times.begin(), times.end());
+    printf("time per bite, s:     min %.1f  p10 %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", times.front(),
+           percentile(times, 0.10), percentile(times, 0.50), percentile(times, 0.90), percentile(times, 0.99), times.back());
+  }
+  if (obstacle_stops) printf("%u bites hit an obstacle and stopped in low power instead of going home\n", obstacle_stops);
+  // A unit that got stuck in a mode has a bug, and so does an overload that stalls the servos until the supply sags, so either
+  // fails the run. Low power for other reasons is how the firmware stops safely, and is only counted.
+  return totals[BITE_STUCK] || obstacle_stops ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "HostBoard.h"
+
+static thread_local HostBoard default_board;
+thread_local HostBoard *host_board = &default_board;
+
+EEPROMClass EEPROM;
+HardwareSerial Serial;
+
+// The registers belong to the board, so each thread has its own like host_board
+thread_local volatile uint8_t TCCR0A, TCCR0B, TIMSK0, OCR0A;
+thread_local volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+thread_local volatile uint16_t TCNT1, ICR1, OCR1A, OCR1B;
+thread_local volatile uint8_t PORTB, PORTD;
+
+// Handlers of the interrupts host_advance raises, for builds without the modules that define them
+extern "C" {
+__attribute__((weak)) void TIMER0_COMPA_vect(void) {}
+__attribute__((weak)) void TIMER1_OVF_vect(void) {}
+__attribute__((weak)) void TIMER1_COMPA_vect(void) {}
+__attribute__((weak)) void TIMER1_COMPB_vect(void) {}
+}
+
+void host_reset(HostBoard &board) {
+  memset(&board, 0, sizeof(HostBoard));
+  memset(board.eeprom, 0xFF, sizeof(board.eeprom));
+  for (uint8_t i = 0; i < HOST_NUM_ANALOG; i++) {
+    board.analog[i] = 512;
+  }
+  board.timer0_next_us = HOST_TIMER0_PERIOD_US / 2;  // Compare A is halfway between overflows, as StatusLed sets it
+  board.timer1_next_us = HOST_TIMER1_PERIOD_US;
+}
+
+void host_advance(unsigned long us) {
+  HostBoard &board = *host_board;
+  unsigned long end = board.now_us + us;
+  while (board.now_us < end) {
+    unsigned long next = min(end, min(board.timer0_next_us, board.timer1_next_us));
+    if (board.device) next = min(next, board.device_time_us + HOST_DEVICE_STEP_US);
+    board.now_us = next;
+    if (board.now_us == board.timer0_next_us) {
+      board.timer0_next_us += HOST_TIMER0_PERIOD_US;
+      if (TIMSK0 & _BV(OCIE0A)) TIMER0_COMPA_vect();
+    }
+    if (board.now_us == board.timer1_next_us) {
+      board.timer1_next_us += HOST_TIMER1_PERIOD_US;
+      // The pulses are not timed within the frame, so both end straight after they start
+      if (TCCR1B & (_BV(CS10) | _BV(CS11) | _BV(CS12))) {
+        if (TIMSK1 & _BV(TOIE1)) TIMER1_OVF_vect();
+        if (TIMSK1 & _BV(OCIE1A)) TIMER1_COMPA_vect();
+        if (TIMSK1 & _BV(OCIE1B)) TIMER1_COMPB_vect();
+      }
+    }
+    if (board.device && board.now_us - board.device_time_us >= HOST_DEVICE_STEP_US) {
+      board.device_time_us = board.now_us;
+      board.device->step(board);
+    }
+  }
+}
+
+// Analog pins can be given either as A0 to A5 or as channel numbers, as in the AVR core
+static uint8_t analog_channel(uint8_t pin) {
+  return (pin >= A0 ? pin - A0 : pin) % HOST_NUM_ANALOG;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  host_advance(HOST_CALL_US);
+  if (pin >= HOST_NUM_PINS) { return; }
+  host_board->pin_mode[pin] = mode;
+  if (mode == INPUT_PULLUP) host_board->pin_level[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  host_advance(HOST_CALL_US);
+  if (pin >= HOST_NUM_PINS) { return; }
+  host_board->pin_level[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  host_advance(HOST_CALL_US);
+  return pin < HOST_NUM_PINS ? host_board->pin_level[pin] : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  host_advance(HOST_ANALOG_READ_US);
+  return host_board->analog[analog_channel(pin)];
+}
+
+void analogWrite(uint8_t pin, int val) {
+  host_advance(HOST_CALL_US);
+  if (pin >= HOST_NUM_PINS) { return; }
+  host_board->pwm[pin] = constrain(val, 0, 255);
+}
+
+unsigned long millis() {
+  host_advance(HOST_CALL_US);
+  return host_board->now_us / 1000;
+}
+
+unsigned long micros() {
+  host_advance(HOST_CALL_US);
+  return host_board->now_us;
+}
+
+void delay(unsigned long ms) {
+  host_advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  host_advance(us);
+}
+
+void HardwareSerial::begin(unsigned long baud) {}
+
+int HardwareSerial::available() {
+  host_advance(HOST_CALL_US);
+  return host_board->rx_len - host_board->rx_pos;
+}
+
+int HardwareSerial::read() {
+  if (host_board->rx_pos >= host_board->rx_len) { return -1; }
+  return host_board->rx[host_board->rx_pos++];
+}
+
+// The port never fills up, so sends never wait
+int HardwareSerial::availableForWrite() {
+  host_advance(HOST_CALL_US);
+  return 63;
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+  if (host_board->tx_len < HOST_SERIAL_BUFFER) host_board->tx[host_board->tx_len++] = b;
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    write(buf[i]);
+  }
+  return len;
+}
@@ -0,0 +1,59 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+// Host stand-in for the Arduino AVR core, with the parts the firmware uses. The hardware behind it is a HostBoard.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define PI 3.1415926535897932384626433832795
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+
+// Macros, as in the AVR core, so mixed argument types behave the same
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define abs(x) ((x) > 0 ? (x) : -(x))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class HardwareSerial {
+public:
+  void begin(unsigned long baud);
+  int available();
+  int read();
+  int availableForWrite();
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buf, size_t len);
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+// Host stand-in for the Arduino EEPROM library, backed by the EEPROM of host_board.
+#include <stdint.h>
+#include <string.h>
+#include "HostBoard.h"
+
+struct EEPROMClass {
+  uint8_t read(int idx) { return host_board->eeprom[idx]; }
+  void write(int idx, uint8_t val) { host_board->eeprom[idx] = val; }
+  void update(int idx, uint8_t val) { host_board->eeprom[idx] = val; }
+  uint16_t length() { return HOST_EEPROM_SIZE; }
+
+  template<typename T> T &get(int idx, T &t) {
+    memcpy(&t, host_board->eeprom + idx, sizeof(T));
+    return t;
+  }
+
+  template<typename T> const T &put(int idx, const T &t) {
+    memcpy(host_board->eeprom + idx, &t, sizeof(T));
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
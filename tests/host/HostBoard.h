@@ -0,0 +1,67 @@
+#ifndef HOSTBOARD_H
+#define HOSTBOARD_H
+#include <stdint.h>
+
+#define HOST_EEPROM_SIZE 1024 /** EEPROM of the ATmega328P */
+#define HOST_NUM_PINS 20 /** Digital pins 0 to 13, then A0 to A5 */
+#define HOST_NUM_ANALOG 8 /** Analog inputs */
+#define HOST_SERIAL_BUFFER 512 /** Bytes kept in each direction of the serial port */
+
+#define HOST_CALL_US 4 /** Time taken by a call to the core, such as digitalRead or micros */
+#define HOST_ANALOG_READ_US 112 /** Time taken by analogRead, one ADC conversion */
+#define HOST_TIMER0_PERIOD_US 1024 /** Timer0 overflows, and reaches each compare value, once every 1024 us */
+#define HOST_TIMER1_PERIOD_US 20000 /** Timer1 period, as set up by ServoDriver */
+#define HOST_DEVICE_STEP_US 1000 /** Longest time between steps of the device attached to a board */
+
+struct HostBoard;
+
+/**
+ * Hardware outside the board, such as the arm and its sensors. It reads the board's outputs and writes its inputs each step.
+ */
+struct HostDevice {
+  /**
+   * @brief Advances the device to the board's time.
+   */
+  virtual void step(HostBoard &board) = 0;
+};
+
+/**
+ * Simulated hardware behind the host stand-in of the Arduino core. The firmware only sees it through the core functions, EEPROM,
+ * Serial and the timer registers, so it builds unchanged. Tests and devices set inputs and inspect outputs here directly.
+ * The firmware is built with -fpack-struct and test code is not, so the board is packed explicitly to share one layout.
+ */
+struct __attribute__((packed)) HostBoard {
+  unsigned long now_us;                // Simulated time since reset, returned by micros()
+  uint8_t eeprom[HOST_EEPROM_SIZE];
+  uint8_t pin_mode[HOST_NUM_PINS];
+  uint8_t pin_level[HOST_NUM_PINS];    // Level written to each output, and read from each input
+  uint8_t pwm[HOST_NUM_PINS];          // Last analogWrite value of each pin
+  uint16_t analog[HOST_NUM_ANALOG];    // Result of analogRead for each input
+  uint8_t rx[HOST_SERIAL_BUFFER];      // Bytes sent to the board, read from rx_pos up to rx_len
+  uint16_t rx_len, rx_pos;
+  uint8_t tx[HOST_SERIAL_BUFFER];      // Bytes the board sent. Later bytes are dropped once it is full.
+  uint16_t tx_len;
+  unsigned long timer0_next_us;        // When Timer0 next reaches its compare value
+  unsigned long timer1_next_us;        // When Timer1 next overflows
+  HostDevice *device;                  // Attached device, or NULL
+  unsigned long device_time_us;        // Time of the device's last step
+};
+
+/**
+ * The board that the core functions act on. Each thread has its own, so threads can run separate units of the firmware.
+ */
+extern thread_local HostBoard *host_board;
+
+/**
+ * @brief Powers a board up: time 0, EEPROM erased to 0xFF, pins low, analog inputs at mid scale, serial buffers empty.
+ */
+void host_reset(HostBoard &board);
+
+/**
+ * @brief Lets time pass on host_board, as the firmware spends it running code. Interrupts that fall due are handled, in time
+ * order, and the attached device is stepped at least every HOST_DEVICE_STEP_US.
+ * Every call to the core spends a little time, so busy waits on millis() or on an input end as they do on the board.
+ */
+void host_advance(unsigned long us);
+
+#endif
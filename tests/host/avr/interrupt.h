@@ -0,0 +1,9 @@
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+// Host stand-in: interrupt handlers are plain functions, called by host_advance when their interrupt would fire.
+
+#define ISR(vector) extern "C" void vector(void)
+#define cli()
+#define sei()
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+// Host stand-in for the ATmega328P registers the firmware uses. They are plain variables, one set per thread like host_board.
+// host_advance reads the interrupt masks and Timer1 clock select to decide which handlers to call, and ServoDriver's pulse widths
+// are read back from OCR1A/B.
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern thread_local volatile uint8_t TCCR0A, TCCR0B, TIMSK0, OCR0A;
+extern thread_local volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern thread_local volatile uint16_t TCNT1, ICR1, OCR1A, OCR1B;
+extern thread_local volatile uint8_t PORTB, PORTD;
+
+// TCCR1A, TCCR1B
+#define WGM10 0
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define CS10 0
+#define CS11 1
+#define CS12 2
+// TIMSK0, TIMSK1, TIFR1
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+// Port bits
+#define PB2 2
+#define PD5 5
+#define PD6 6
+
+#endif
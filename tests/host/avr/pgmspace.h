@@ -0,0 +1,16 @@
+#ifndef __PGMSPACE_H_
+#define __PGMSPACE_H_
+// Host stand-in: program memory is ordinary memory.
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+#define memcpy_P memcpy
+
+#endif
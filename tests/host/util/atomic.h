@@ -0,0 +1,9 @@
+#ifndef _UTIL_ATOMIC_H_
+#define _UTIL_ATOMIC_H_
+// Host stand-in: interrupt handlers only run inside calls to the core, and no atomic block makes one, so every block is atomic.
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON 1
+#define ATOMIC_BLOCK(type) for (uint8_t __todo = 1; __todo; __todo = 0)
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef _UTIL_CRC16_H_
+#define _UTIL_CRC16_H_
+// Host versions of the avr-libc CRC updates the firmware uses, with the same results.
+#include <stdint.h>
+
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data) {
+  crc ^= data;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+#endif
@@ -0,0 +1,3 @@
+// Linkage lengths from AutoFeeder.ino, for tests that do not link the sketch
+extern const float L1 = 100.0;
+extern const float L2 = 100.0;
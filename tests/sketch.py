@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+"""Converts AutoFeeder.ino to C++ as the Arduino IDE does: includes Arduino.h, and declares every function before its first use.
+
+Usage: sketch.py AutoFeeder.ino > AutoFeeder.cpp
+"""
+import re
+import sys
+
+# A function definition at the start of a line: return type, name, arguments, then the opening brace
+DEFINITION = re.compile(r'^((?:static\s+)?[A-Za-z_][\w\s\*&:<>]*?[\s\*&]+)([A-Za-z_]\w*)\s*\(([^;{}]*?)\)\s*\{', re.M)
+
+
+def prototypes(source):
+    result = []
+    for ret, name, args in DEFINITION.findall(source):
+        if name in ('if', 'while', 'for', 'switch'):
+            continue
+        args = re.sub(r'=[^,)]*', '', args)  # Default arguments only go on the first declaration
+        result.append('%s %s(%s);' % (' '.join(ret.split()), name, ' '.join(args.split())))
+    return result
+
+
+def main():
+    path = sys.argv[1]
+    with open(path) as f:
+        lines = f.read().split('\n')
+    source = '\n'.join(lines)
+    # The prototypes go after the includes, on the same line as the code that follows, so line numbers stay the same
+    last_include = max(i for i, line in enumerate(lines) if line.startswith('#include'))
+    lines[last_include + 1] = ' '.join(prototypes(source)) + ' ' + lines[last_include + 1]
+    print('#include <Arduino.h>')
+    print('#line 1 "%s"' % path)
+    print('\n'.join(lines))
+
+
+if __name__ == '__main__':
+    main()
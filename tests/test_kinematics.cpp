@@ -0,0 +1,146 @@
+// Properties of the kinematics, checked over random points and poses:
+// - constrain_ik_point keeps points in the workspace, and constraining twice changes nothing
+// - every constrained point solves, with both joints in their servo ranges, and FK(IK(p)) returns to p
+// - solve_ik agrees with a double precision reference, so a faster implementation can be swapped in and checked here
+#include <math.h>
+#include <stdio.h>
+#include "check.h"
+#include "firmware.h"
+
+#define ROUND_TRIP_TOLERANCE 0.01 /** mm */
+#define IDEMPOTENT_TOLERANCE 0.0001 /** mm */
+#define WORKSPACE_TOLERANCE 0.001 /** mm */
+
+// Reference kinematics in double precision, independent of kinematics.cpp
+static void reference_fk(double q1, double q2, double &x, double &y) {
+  x = L1 * cos(q1) + L2 * cos(q1 + q2);
+  y = L1 * sin(q1) + L2 * sin(q1 + q2);
+}
+
+static bool in_servo_ranges(float q1, float q2) {
+  return q1 >= Q1_MIN && q1 <= Q1_MAX && q2 >= Q2_MIN && q2 <= Q2_MAX;
+}
+
+/**
+ * A random point, sometimes from the awkward places: non-finite, the origin, on a reach limit, or near the q1 boundary circle.
+ */
+static void random_point(float &x, float &y) {
+  switch (rand_u32() % 16) {
+    case 0: x = NAN; y = rand_float(-300, 300); return;
+    case 1: x = rand_float(-300, 300); y = (rand_u32() & 1) ? INFINITY : -INFINITY; return;
+    case 2: x = 0; y = 0; return;
+    case 3: {
+      float a = rand_float(-M_PI, 0);
+      float r = (rand_u32() & 1) ? L1 + L2 : 10;
+      x = r * cos(a);
+      y = r * sin(a);
+      return;
+    }
+    case 4: {
+      float a = rand_float(-M_PI, 0);
+      x = -L1 + L1 * cos(a);
+      y = L1 * sin(a);
+      return;
+    }
+    case 5: x = rand_float(-1e6, 1e6); y = rand_float(-1e6, 1e6); return;
+    default: x = rand_float(-300, 300); y = rand_float(-300, 300); return;
+  }
+}
+
+static void check_constrain(float x0, float y0) {
+  float x = x0, y = y0;
+  constrain_ik_point(x, y);
+  CHECK(isfinite(x) && isfinite(y), "(%g, %g) -> (%g, %g)", x0, y0, x, y);
+  float mag = sqrt(x * x + y * y);
+  CHECK(y < 0, "(%g, %g) -> (%g, %g) is not below the shoulder", x0, y0, x, y);
+  CHECK(mag <= L1 + L2 + WORKSPACE_TOLERANCE && mag >= 10 - WORKSPACE_TOLERANCE, "(%g, %g) -> (%g, %g) is out of reach", x0, y0, x, y);
+  CHECK(hypot(x + L1, y) >= L1 - WORKSPACE_TOLERANCE, "(%g, %g) -> (%g, %g) needs q1 past -PI", x0, y0, x, y);
+  float x2 = x, y2 = y;
+  constrain_ik_point(x2, y2);
+  CHECK(fabs(x2 - x) <= IDEMPOTENT_TOLERANCE && fabs(y2 - y) <= IDEMPOTENT_TOLERANCE,
+        "(%g, %g) -> (%g, %g) -> (%g, %g)", x0, y0, x, y, x2, y2);
+
+  float q1, q2;
+  if (!calc_ik(x, y, q1, q2)) {
+    CHECK(false, "constrained (%g, %g) from (%g, %g) has no solution", x, y, x0, y0);
+    return;
+  }
+  CHECK(in_servo_ranges(q1, q2), "(%g, %g) -> q = (%g, %g)", x, y, q1, q2);
+  float fx, fy;
+  CHECK(calc_fk(q1, q2, fx, fy), "calc_fk(%g, %g) is not finite", q1, q2);
+  CHECK(fabs(fx - x) <= ROUND_TRIP_TOLERANCE && fabs(fy - y) <= ROUND_TRIP_TOLERANCE,
+        "(%g, %g) -> q = (%g, %g) -> (%g, %g)", x, y, q1, q2, fx, fy);
+  double rx, ry;
+  reference_fk(q1, q2, rx, ry);
+  CHECK(fabs(rx - x) <= ROUND_TRIP_TOLERANCE && fabs(ry - y) <= ROUND_TRIP_TOLERANCE,
+        "(%g, %g) -> q = (%g, %g) -> reference (%g, %g)", x, y, q1, q2, rx, ry);
+}
+
+/**
+ * Solves from a random current pose. Whenever a pose exists within the servo ranges, solve_ik must find one, and it must be the
+ * branch nearest the current pose.
+ */
+static void check_solve_from_pose() {
+  float q1, q2;
+  double x, y;
+  // Folded poses within 10 mm of the shoulder are outside the workspace, and float precision degrades there
+  do {
+    q1 = rand_float(Q1_MIN, Q1_MAX);
+    q2 = rand_float(Q2_MIN, Q2_MAX);
+    reference_fk(q1, q2, x, y);
+  } while (hypot(x, y) < 10);
+  float q1_cur = rand_float(Q1_MIN, Q1_MAX), q2_cur = rand_float(Q2_MIN, Q2_MAX);
+  float s1 = -100, s2 = -100;
+  uint8_t result = solve_ik(x, y, q1_cur, q2_cur, s1, s2);
+  CHECK(result == IK_OK, "pose (%g, %g) at (%g, %g) gave %d", q1, q2, x, y, result);
+  if (result != IK_OK) { return; }
+  CHECK(in_servo_ranges(s1, s2), "(%g, %g) -> q = (%g, %g)", x, y, s1, s2);
+  double rx, ry;
+  reference_fk(s1, s2, rx, ry);
+  CHECK(fabs(rx - x) <= ROUND_TRIP_TOLERANCE && fabs(ry - y) <= ROUND_TRIP_TOLERANCE,
+        "(%g, %g) -> q = (%g, %g) -> (%g, %g)", x, y, s1, s2, rx, ry);
+  // The other elbow branch mirrors the arm about the line from the shoulder to the point
+  double a = atan2(y, x);
+  double o1 = 2 * a - s1, o2 = -s2;
+  if (o1 < Q1_MIN - Q_LIMIT_TOLERANCE) o1 += 2 * M_PI;
+  if (o1 > Q1_MAX + Q_LIMIT_TOLERANCE) o1 -= 2 * M_PI;
+  if (o2 < Q2_MIN - Q_LIMIT_TOLERANCE) o2 += 2 * M_PI;
+  bool other_valid = o1 >= Q1_MIN && o1 <= Q1_MAX && o2 >= Q2_MIN && o2 <= Q2_MAX;
+  double chosen = fabs(s1 - q1_cur) + fabs(s2 - q2_cur);
+  double other = fabs(o1 - q1_cur) + fabs(o2 - q2_cur);
+  CHECK(!other_valid || chosen <= other + 0.01, "(%g, %g) from (%g, %g) chose (%g, %g) over nearer (%g, %g)",
+        x, y, q1_cur, q2_cur, s1, s2, o1, o2);
+}
+
+static void check_unreachable() {
+  float a = rand_float(-M_PI, M_PI);
+  float r = rand_float(L1 + L2 + 0.5, 1000);
+  float q1 = -1, q2 = 1;
+  uint8_t result = solve_ik(r * cos(a), r * sin(a), q1, q2, q1, q2);
+  CHECK(result == IK_UNREACHABLE, "r = %g gave %d", r, result);
+  CHECK(q1 == -1 && q2 == 1, "outputs were written for an unreachable point");
+  CHECK(solve_ik(NAN, 0, q1, q2, q1, q2) == IK_UNREACHABLE, "NaN is reachable");
+}
+
+static void check_fk_finite() {
+  float q1 = rand_float(-10, 10), q2 = rand_float(-10, 10);
+  float x, y;
+  CHECK(calc_fk(q1, q2, x, y), "calc_fk(%g, %g) reported a non-finite result", q1, q2);
+  CHECK(hypot(x, y) <= L1 + L2 + WORKSPACE_TOLERANCE, "calc_fk(%g, %g) = (%g, %g) is out of reach", q1, q2, x, y);
+  CHECK(!calc_fk(NAN, q2, x, y), "calc_fk of NaN reported a finite result");
+}
+
+int main(int argc, char **argv) {
+  check_begin(argc, argv, 200000);
+  for (uint32_t i = 0; i < check_iterations(); i++) {
+    float x, y;
+    random_point(x, y);
+    check_constrain(x, y);
+    check_solve_from_pose();
+    if (i % 16 == 0) {
+      check_unreachable();
+      check_fk_finite();
+    }
+  }
+  return check_end("kinematics");
+}
@@ -0,0 +1,146 @@
+// Properties of the MotionPlanner, which replaced balance_speed, checked over random moves:
+// - every plan has a finite, non-negative duration, starts where it was planned from and ends where it was planned to
+// - progress along a move never reverses, and no joint, tip or tilt exceeds its speed limit on the way
+// - moves too short to plan (including no move at all) are done at once instead of producing NaN
+#include <math.h>
+#include <stdio.h>
+#include "check.h"
+#include "firmware.h"
+
+#define SAMPLES 64 /** Samples taken along each move */
+#define POSITION_TOLERANCE 0.0005 /** rad, or mm / 100 for line moves */
+#define SPEED_TOLERANCE 1.02 /** Sampled speeds may exceed their limit by this factor, for the error of finite differences */
+
+/**
+ * A random speed scale, sometimes a tiny one.
+ */
+static float random_scale() {
+  switch (rand_u32() % 8) {
+    case 0: return rand_float(0.001, 0.05);
+    case 1: return 1;
+    default: return rand_float(0.05, 2);
+  }
+}
+
+/**
+ * A random joint distance, sometimes none or a tiny one.
+ */
+static float random_delta(float range) {
+  switch (rand_u32() % 8) {
+    case 0: return 0;
+    case 1: return rand_float(-1e-5, 1e-5);
+    default: return rand_float(-range, range);
+  }
+}
+
+static bool timing_ok(const PathTiming &timing) {
+  return isfinite(timing.t_total) && timing.t_total >= 0 && isfinite(timing.t_accel) && timing.t_accel >= 0
+      && timing.t_accel <= 0.5 * timing.t_total * (1 + 1e-5) + 1e-6 && isfinite(timing.t_jerk) && timing.t_jerk >= 0;
+}
+
+static void check_joint_move() {
+  float q1_from = rand_float(Q1_MIN, Q1_MAX), q2_from = rand_float(Q2_MIN, Q2_MAX);
+  float q1_to = q1_from + random_delta(Q1_MAX - Q1_MIN), q2_to = q2_from + random_delta(Q2_MAX - Q2_MIN);
+  float scale = random_scale();
+  JointMove move;
+  MotionPlanner::plan(move, q1_from, q2_from, q1_to, q2_to, scale);
+  const PathTiming &timing = move.timing;
+  CHECK(timing_ok(timing), "(%g, %g) -> (%g, %g) at %g: t_total %g, t_accel %g, t_jerk %g",
+        q1_from, q2_from, q1_to, q2_to, scale, timing.t_total, timing.t_accel, timing.t_jerk);
+  if (!timing_ok(timing)) { return; }
+
+  float q1, q2;
+  bool done = MotionPlanner::sample(move, 0, q1, q2);
+  CHECK(fabs(q1 - q1_from) <= POSITION_TOLERANCE && fabs(q2 - q2_from) <= POSITION_TOLERANCE,
+        "(%g, %g) -> (%g, %g) starts at (%g, %g)", q1_from, q2_from, q1_to, q2_to, q1, q2);
+  CHECK(!done || timing.t_total == 0, "(%g, %g) -> (%g, %g) lasting %g is done at 0", q1_from, q2_from, q1_to, q2_to, timing.t_total);
+  done = MotionPlanner::sample(move, timing.t_total, q1, q2);
+  CHECK(done, "(%g, %g) -> (%g, %g) is not done at its end", q1_from, q2_from, q1_to, q2_to);
+  CHECK(fabs(q1 - q1_to) <= POSITION_TOLERANCE && fabs(q2 - q2_to) <= POSITION_TOLERANCE,
+        "(%g, %g) -> (%g, %g) ends at (%g, %g)", q1_from, q2_from, q1_to, q2_to, q1, q2);
+
+  float dt = timing.t_total / SAMPLES;
+  float q1_prev = q1_from, q2_prev = q2_from;
+  for (uint8_t i = 1; i <= SAMPLES && dt > 0; i++) {
+    MotionPlanner::sample(move, i * dt, q1, q2);
+    CHECK(isfinite(q1) && isfinite(q2), "(%g, %g) -> (%g, %g) at %g s", q1_from, q2_from, q1_to, q2_to, i * dt);
+    // Moving back toward the start would show as the distance to the end growing
+    CHECK(fabs(q1_to - q1) <= fabs(q1_to - q1_prev) + 1e-6 && fabs(q2_to - q2) <= fabs(q2_to - q2_prev) + 1e-6,
+          "(%g, %g) -> (%g, %g) reverses at %g s", q1_from, q2_from, q1_to, q2_to, i * dt);
+    CHECK(fabs(q1 - q1_prev) / dt <= Q1_MAX_SPEED * scale * SPEED_TOLERANCE + 1e-3
+          && fabs(q2 - q2_prev) / dt <= Q2_MAX_SPEED * scale * SPEED_TOLERANCE + 1e-3,
+          "(%g, %g) -> (%g, %g) at %g moves at (%g, %g) rad/s", q1_from, q2_from, q1_to, q2_to, scale,
+          (q1 - q1_prev) / dt, (q2 - q2_prev) / dt);
+    q1_prev = q1;
+    q2_prev = q2;
+  }
+}
+
+/**
+ * A random constrained point, that the arm reaches from some joints within the servo ranges.
+ */
+static void random_tip(float &x, float &y) {
+  x = rand_float(-200, 200);
+  y = rand_float(-200, 0);
+  constrain_ik_point(x, y);
+}
+
+static void check_line_move() {
+  float x_from, y_from, x_to, y_to;
+  random_tip(x_from, y_from);
+  if (rand_u32() % 8 == 0) {
+    x_to = x_from + rand_float(-1e-4, 1e-4);
+    y_to = y_from;
+  } else {
+    random_tip(x_to, y_to);
+  }
+  float q1_cur, q2_cur;
+  if (!calc_ik(x_from, y_from, q1_cur, q2_cur)) {
+    CHECK(false, "constrained (%g, %g) has no solution", x_from, y_from);
+    return;
+  }
+  float scale = random_scale();
+  float accel = rand_float(50, 1000);
+  float jerk = (rand_u32() & 1) ? 0 : rand_float(100, 10000);
+  LineMove move;
+  if (!MotionPlanner::plan_line(move, x_from, y_from, x_to, y_to, q1_cur, q2_cur, scale, accel, jerk)) {
+    return;  // A line can cut across the unreachable region between two reachable points
+  }
+  const PathTiming &timing = move.timing;
+  CHECK(timing_ok(timing), "(%g, %g) -> (%g, %g) at %g, accel %g, jerk %g: t_total %g, t_accel %g, t_jerk %g",
+        x_from, y_from, x_to, y_to, scale, accel, jerk, timing.t_total, timing.t_accel, timing.t_jerk);
+  if (!timing_ok(timing)) { return; }
+
+  float x, y;
+  CHECK(MotionPlanner::sample_line(move, timing.t_total, x, y), "(%g, %g) -> (%g, %g) is not done at its end",
+        x_from, y_from, x_to, y_to);
+  CHECK(fabs(x - x_to) <= 100 * POSITION_TOLERANCE && fabs(y - y_to) <= 100 * POSITION_TOLERANCE,
+        "(%g, %g) -> (%g, %g) ends at (%g, %g)", x_from, y_from, x_to, y_to, x, y);
+
+  float dt = timing.t_total / SAMPLES;
+  float x_prev = x_from, y_prev = y_from;
+  float q1 = q1_cur, q2 = q2_cur;
+  for (uint8_t i = 1; i <= SAMPLES && dt > 0; i++) {
+    MotionPlanner::sample_line(move, i * dt, x, y);
+    CHECK(isfinite(x) && isfinite(y), "(%g, %g) -> (%g, %g) at %g s", x_from, y_from, x_to, y_to, i * dt);
+    float tip_speed = sqrt((x - x_prev) * (x - x_prev) + (y - y_prev) * (y - y_prev)) / dt;
+    CHECK(tip_speed <= LINE_MAX_SPEED * scale * SPEED_TOLERANCE + 1e-2, "(%g, %g) -> (%g, %g) at %g moves at %g mm/s",
+          x_from, y_from, x_to, y_to, scale, tip_speed);
+    float q1_next, q2_next;
+    CHECK(solve_ik(x, y, q1, q2, q1_next, q2_next) == IK_OK, "(%g, %g) -> (%g, %g) passes unreachable (%g, %g)",
+          x_from, y_from, x_to, y_to, x, y);
+    x_prev = x;
+    y_prev = y;
+    q1 = q1_next;
+    q2 = q2_next;
+  }
+}
+
+int main(int argc, char **argv) {
+  check_begin(argc, argv, 50000);
+  for (uint32_t i = 0; i < check_iterations(); i++) {
+    check_joint_move();
+    check_line_move();
+  }
+  return check_end("motion");
+}
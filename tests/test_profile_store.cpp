@@ -0,0 +1,157 @@
+// Properties of the profile store, checked over random EEPROM images:
+// - load_profiles accepts any image, and afterwards every profile loads, with its points in the workspace
+// - a save is read back unchanged, and survives reloading the store
+// - saving keeps working past the 16 bit sequence numbers of the records
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+#include "firmware.h"
+
+#define CONSTRAIN_TOLERANCE (1.0 / PROFILE_UNITS_PER_MM) /** mm. Stored points are rounded to profile units after they are constrained. */
+
+/**
+ * Fills the EEPROM with a random image: noise, erased, or a valid store with a few bits flipped.
+ */
+static void random_image() {
+  switch (rand_u32() % 4) {
+    case 0:
+      for (uint16_t i = 0; i < HOST_EEPROM_SIZE; i++) {
+        host_board->eeprom[i] = rand_u32();
+      }
+      break;
+    case 1:
+      memset(host_board->eeprom, (rand_u32() & 1) ? 0xFF : 0x00, HOST_EEPROM_SIZE);
+      break;
+    default: {
+      uint16_t flips = rand_u32() % 8;
+      for (uint16_t i = 0; i < flips; i++) {
+        host_board->eeprom[rand_u32() % HOST_EEPROM_SIZE] ^= 1 << (rand_u32() % 8);
+      }
+      break;
+    }
+  }
+}
+
+static bool profile_ok(const Profile &p) {
+  if (p.num_points < MIN_PROFILE_POINTS || p.num_points > MAX_PROFILE_POINTS) { return false; }
+  for (uint8_t i = 0; i < p.num_points; i++) {
+    float x, y;
+    get_profile_point(p, i, x, y);
+    float cx = x, cy = y;
+    constrain_ik_point(cx, cy);
+    if (fabs(cx - x) > CONSTRAIN_TOLERANCE || fabs(cy - y) > CONSTRAIN_TOLERANCE) { return false; }
+    float q1, q2;
+    if (!calc_ik(cx, cy, q1, q2)) { return false; }
+  }
+  return true;
+}
+
+static void check_all_profiles(const char *when) {
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    Profile p;
+    if (!load_profile(i, p)) {
+      CHECK(false, "profile %u does not load %s", i, when);
+      continue;
+    }
+    CHECK(profile_ok(p), "profile %u has %u points, some outside the workspace, %s", i, p.num_points, when);
+  }
+}
+
+/**
+ * A random profile, with points anywhere in the range of the stored coordinates.
+ */
+static Profile random_profile() {
+  Profile p;
+  memset(&p, 0, sizeof(Profile));
+  p.num_points = MIN_PROFILE_POINTS + rand_u32() % (MAX_PROFILE_POINTS - MIN_PROFILE_POINTS + 1);
+  for (uint8_t i = 0; i < p.num_points; i++) {
+    p.points[i].x = (int16_t)(rand_u32() % (2 * PROFILE_COORD_LIMIT + 1)) - PROFILE_COORD_LIMIT;
+    p.points[i].y = (int16_t)(rand_u32() % (2 * PROFILE_COORD_LIMIT + 1)) - PROFILE_COORD_LIMIT;
+  }
+  for (uint8_t i = 0; i < p.num_points - 1; i++) {
+    p.segments[i] = rand_u32();
+  }
+  p.carry = rand_u32();
+  return p;
+}
+
+/**
+ * Saves a random profile, and checks it reads back as saved, once constrained to the workspace.
+ */
+static void check_save(Profile saved[NUM_PROFILES]) {
+  uint8_t idx = rand_u32() % NUM_PROFILES;
+  Profile p = random_profile();
+  if (!save_profile(p, idx)) {
+    CHECK(false, "saving profile %u failed", idx);
+    return;
+  }
+  Profile loaded;
+  if (!load_profile(idx, loaded)) {
+    CHECK(false, "profile %u does not load after saving", idx);
+    return;
+  }
+  CHECK(profile_ok(loaded), "profile %u loads outside the workspace after saving", idx);
+  CHECK(loaded.num_points == p.num_points && memcmp(loaded.segments, p.segments, p.num_points - 1) == 0
+        && loaded.carry == p.carry, "profile %u loads with different points or segments", idx);
+  saved[idx] = loaded;
+}
+
+static void check_fuzzed_store() {
+  random_image();
+  load_profiles();
+  check_all_profiles("after loading a random image");
+  // Loading again must find the repaired store intact, with the same profiles
+  Profile before[NUM_PROFILES];
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    load_profile(i, before[i]);
+  }
+  CHECK(load_profiles(), "the repaired store is not intact on the next load");
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    Profile p;
+    CHECK(load_profile(i, p) && memcmp(&p, &before[i], sizeof(Profile)) == 0, "profile %u changed on reload", i);
+  }
+  Profile saved[NUM_PROFILES];
+  memcpy(saved, before, sizeof(saved));
+  for (uint8_t i = rand_u32() % 4; i > 0; i--) {
+    check_save(saved);
+  }
+  CHECK(load_profiles(), "the store is not intact after saving");
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    Profile p;
+    CHECK(load_profile(i, p) && memcmp(&p, &saved[i], sizeof(Profile)) == 0, "profile %u changed after saving and reloading", i);
+  }
+}
+
+/**
+ * Saves more times than the sequence numbers count to, reloading now and then as after a reset.
+ */
+static void check_many_saves() {
+  host_reset(*host_board);
+  load_profiles();
+  Profile saved[NUM_PROFILES];
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    load_profile(i, saved[i]);
+  }
+  for (uint32_t i = 0; i < 140000; i++) {
+    check_save(saved);
+    if (i % 9973 == 0) {
+      CHECK(load_profiles(), "the store is not intact after %u saves", i + 1);
+    }
+  }
+  load_profiles();
+  for (uint8_t i = 0; i < NUM_PROFILES; i++) {
+    Profile p;
+    CHECK(load_profile(i, p) && memcmp(&p, &saved[i], sizeof(Profile)) == 0, "profile %u was lost over many saves", i);
+  }
+}
+
+int main(int argc, char **argv) {
+  check_begin(argc, argv, 5000);
+  host_reset(*host_board);
+  for (uint32_t i = 0; i < check_iterations(); i++) {
+    check_fuzzed_store();
+  }
+  check_many_saves();
+  return check_end("profile store");
+}
@@ -0,0 +1,92 @@
+// The whole sketch scooping from a modeled bowl, through the contact and overload paths of scoop_step:
+// - a bowl below the profile is scooped without contact
+// - a bowl above the bottom of the profile makes the spoon back off when current passes THRESHOLD_CURRENT, and the scoop still
+//   completes, without ever reaching OVERLOAD_CURRENT, and the offset it needed is learned and used by the next scoop
+// - a rigid obstacle passes OVERLOAD_CURRENT, which logs EVENT_SCOOP_OVERLOAD and sends the arm home without lifting
+#include <stdio.h>
+#include "check.h"
+#include "firmware.h"
+#include "Bench.h"
+
+#define THRESHOLD_CURRENT 400 /** As in the sketch */
+#define OVERLOAD_CURRENT 500 /** As in the sketch */
+#define SCOOP_TIMEOUT 60000 /** ms to wait for a scoop to reach the user */
+#define RETURN_TIMEOUT 30000 /** ms to wait for the arm to get back to wait_mode */
+
+/**
+ * Powers up, sends the arm home from where it starts, at the user, and presses the input for a scoop.
+ */
+static bool start_scoop(Bench &bench) {
+  bench.power_up();
+  if (!bench.run_until(feed_wait_step, SCOOP_TIMEOUT)) { return false; }
+  bench.press_input(100);
+  if (!bench.run_until(wait_mode, RETURN_TIMEOUT)) { return false; }
+  bench.plant.max_depth = 0;
+  bench.plant.max_current = 0;
+  bench.press_input(100);
+  return bench.run_until(scoop_step, SCOOP_TIMEOUT);
+}
+
+/**
+ * Serves a bite from a scoop that has started, then returns.
+ */
+static bool serve(Bench &bench) {
+  if (!bench.run_until(feed_wait_step, SCOOP_TIMEOUT)) { return false; }
+  bench.press_input(100);
+  return bench.run_until(wait_mode, RETURN_TIMEOUT);
+}
+
+static void check_no_contact() {
+  Bench bench;
+  CHECK(start_scoop(bench), "no scoop started");
+  CHECK(serve(bench), "the scoop did not reach the user and return, mode %u", cur_mode_id);
+  CHECK(bench.plant.max_depth == 0, "the spoon touched the bowl, %g mm deep", bench.plant.max_depth);
+  CHECK(bench.plant.max_current < THRESHOLD_CURRENT, "current reached %u", bench.plant.max_current);
+  CHECK(!bench.logged(EVENT_SCOOP_OVERLOAD), "an overload was logged");
+}
+
+static void check_threshold() {
+  Bench bench;
+  bench.plant.bowl_bottom_y = -168;  // 7 mm above the bottom of the default bowl profile
+  CHECK(start_scoop(bench), "no scoop started");
+  CHECK(serve(bench), "the scoop did not reach the user and return, mode %u", cur_mode_id);
+  CHECK(bench.plant.max_current > THRESHOLD_CURRENT, "current only reached %u, the spoon never backed off", bench.plant.max_current);
+  CHECK(bench.plant.max_current < OVERLOAD_CURRENT, "current reached %u", bench.plant.max_current);
+  CHECK(!bench.logged(EVENT_SCOOP_OVERLOAD), "an overload was logged");
+  CHECK(bench.visits(scoop_step) == 1 && bench.visits(lift_step_fk) == 2, "scooped %u times and lifted %u times, with the lift at power up",
+        bench.visits(scoop_step), bench.visits(lift_step_fk));
+  // The bottom of the bowl profile is segment 1, from (-70, -175) to (0, -175)
+  CHECK(ScoopLearning::offset(1) > 0, "the offset learned for the bottom is %g", ScoopLearning::offset(1));
+  float first_depth = bench.plant.max_depth;
+
+  // The next scoop starts at the learned offset, so it pushes into the bowl less
+  bench.plant.max_depth = 0;
+  bench.press_input(100);
+  CHECK(bench.run_until(scoop_step, SCOOP_TIMEOUT), "no second scoop started");
+  CHECK(serve(bench), "the second scoop did not reach the user and return, mode %u", cur_mode_id);
+  CHECK(bench.visits(lift_step_fk) == 3, "the second scoop was not lifted to the user");
+  CHECK(!bench.logged(EVENT_IK_UNREACHABLE), "the learned offset took a point out of reach");
+  CHECK(bench.plant.max_depth <= first_depth, "the second scoop went %g mm deep, the first %g mm", bench.plant.max_depth, first_depth);
+}
+
+static void check_overload() {
+  Bench bench;
+  bench.plant.bowl_bottom_y = -168;
+  bench.plant.contact_current = 20000;  // A rigid obstacle, so current jumps past the threshold between two readings
+  CHECK(start_scoop(bench), "no scoop started");
+  CHECK(bench.run_until(move_home_then_wait, SCOOP_TIMEOUT), "the scoop did not go home, mode %u", cur_mode_id);
+  CHECK(bench.plant.max_current > OVERLOAD_CURRENT, "current only reached %u", bench.plant.max_current);
+  CHECK(bench.visits(lift_step_fk) == 1, "the spoon was lifted to the user after the overload");  // The lift at power up
+  CHECK(bench.run_until(wait_mode, RETURN_TIMEOUT), "the arm did not get back to wait_mode, mode %u", cur_mode_id);
+  bench.run(100);  // Let EventLog write the event
+  CHECK(bench.logged(EVENT_SCOOP_OVERLOAD), "no EVENT_SCOOP_OVERLOAD was logged");
+  CHECK(!bench.in_mode(low_power_mode), "the overload tripped low power");
+}
+
+int main(int argc, char **argv) {
+  check_begin(argc, argv, 1);
+  check_isolated("no contact", check_no_contact);
+  check_isolated("threshold", check_threshold);
+  check_isolated("overload", check_overload);
+  return check_end("scoop");
+}
@@ -0,0 +1,148 @@
+"""Frame parsing for the AutoFeeder serial link (see SerialLink.h).
+
+Frame layout: [0xA5][type][payload length][payload...][CRC-8 of type, length and payload]
+"""
+import struct
+import time
+
+FRAME_SYNC = 0xA5
+FRAME_MAX_PAYLOAD = 32
+
+FRAME_TELEMETRY = 0x01
+FRAME_LOOP_STATS = 0x02
+FRAME_EVENT = 0x03
+FRAME_ACK = 0x04
+FRAME_PROFILE_LIST = 0x05
+FRAME_PROFILE = 0x06
+FRAME_SERVO_CAL = 0x07
+FRAME_STREAM_STATUS = 0x08
+
+FRAME_CMD_LOOP_STATS = 0x81
+FRAME_CMD_EVENT_LOG = 0x82
+FRAME_CMD_LIST = 0x83
+FRAME_CMD_READ_PROFILE = 0x84
+FRAME_CMD_WRITE_PROFILE = 0x85
+FRAME_CMD_ACTIVATE = 0x86
+FRAME_CMD_READ_CAL = 0x87
+FRAME_CMD_WRITE_CAL = 0x88
+FRAME_CMD_BEGIN = 0x89
+FRAME_CMD_END = 0x8A
+FRAME_CMD_STREAM = 0x8B
+FRAME_CMD_TELEMETRY = 0x8C
+
+ACK_NAMES = ["ok", "bad request", "busy", "write failed"]
+
+# Mode ids, in the order of MODES in AutoFeeder.ino
+MODE_NAMES = [
+    "move_home_then_wait", "wait_mode", "calibration_mode", "servo_calibration_mode", "low_power_mode",
+    "rotate_plate_step", "descend_step", "scoop_step", "lift_step_fk", "feed_wait_step", "return_step",
+    "cancel_scoop_up_step", "cancel_scoop_out_step", "host_mode", "stream_mode",
+]
+
+
+def mode_name(mode_id):
+    return MODE_NAMES[mode_id] if mode_id < len(MODE_NAMES) else "mode_%d" % mode_id
+
+
+def crc8(data, crc=0):
+    """CRC-8 with polynomial 0x07, matching crc8() in Checksum.cpp."""
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def encode_frame(frame_type, payload=b""):
+    if len(payload) > FRAME_MAX_PAYLOAD:
+        raise ValueError("payload too long")
+    body = bytes([frame_type, len(payload)]) + bytes(payload)
+    return bytes([FRAME_SYNC]) + body + bytes([crc8(body)])
+
+
+class FrameParser:
+    """Incremental frame parser. Feed it bytes, and it returns complete frames with valid CRCs."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.bad_frames = 0
+
+    def feed(self, data):
+        self.buf.extend(data)
+        frames = []
+        while True:
+            start = self.buf.find(FRAME_SYNC)
+            if start < 0:
+                self.buf.clear()
+                break
+            del self.buf[:start]
+            if len(self.buf) < 3:
+                break
+            length = self.buf[2]
+            if length > FRAME_MAX_PAYLOAD:
+                del self.buf[0]
+                self.bad_frames += 1
+                continue
+            if len(self.buf) < length + 4:
+                break
+            body = bytes(self.buf[1:3 + length])
+            if crc8(body) != self.buf[3 + length]:
+                # Not a real frame start, resynchronize on the next sync byte
+                del self.buf[0]
+                self.bad_frames += 1
+                continue
+            frames.append((body[0], body[2:]))
+            del self.buf[:length + 4]
+        return frames
+
+
+def open_source(path, baud=115200):
+    """Opens a capture file, or a serial port if the path looks like one (needs pyserial)."""
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        return serial.Serial(path, baud, timeout=0.1)
+    return open(path, "rb")
+
+
+def read_frames(src, parser=None):
+    """Yields (type, payload) for every valid frame from a file until EOF, or from a serial port forever."""
+    parser = parser or FrameParser()
+    live = hasattr(src, "baudrate")
+    while True:
+        data = src.read(256)
+        if not data and not live:
+            return
+        for frame in parser.feed(data):
+            yield frame
+
+
+def read_eeprom_dump(path):
+    """Reads a 1 KB EEPROM image saved as raw binary or Intel HEX (avrdude -U eeprom:r:file:r or :i)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(b":"):
+        return bytearray(data)
+    image = bytearray(b"\xff" * 1024)
+    for line in data.decode("ascii").split():
+        rec = bytes.fromhex(line[1:])
+        count, addr, kind = rec[0], (rec[1] << 8) | rec[2], rec[3]
+        if kind == 0:
+            image[addr:addr + count] = rec[4:4 + count]
+    return image
+
+
+def unpack(fmt, payload):
+    return struct.unpack(fmt, payload[:struct.calcsize(fmt)])
+
+
+def request(port, frame_type, payload=b"", reply_types=(FRAME_ACK,), timeout=1.0, parser=None):
+    """Sends a command and returns the first (type, payload) reply of one of reply_types, or None on timeout.
+    Telemetry and other frames that arrive in the meantime are skipped."""
+    parser = parser or FrameParser()
+    port.write(encode_frame(frame_type, payload))
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        for reply_type, reply in parser.feed(port.read(64)):
+            if reply_type in reply_types and (reply_type != FRAME_ACK or reply[0] == frame_type):
+                return reply_type, reply
+    return None
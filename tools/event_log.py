@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Prints the AutoFeeder fault/event log.
+
+Usage:
+    event_log.py /dev/ttyACM0 [--clear]   (requests the log over the serial port; needs pyserial)
+    event_log.py eeprom.bin               (reads an EEPROM image, e.g. from avrdude -U eeprom:r:eeprom.bin:r)
+"""
+import argparse
+import sys
+import time
+
+import aflink
+
+# Mirrors EventRecord in EventLog.h, and its location in EEPROMMap.h
+EVENT_FORMAT = "<BBBBHBBB"
+EVENT_SIZE = 9
+EVENT_LOG_START = 720
+EVENT_LOG_ENTRIES = 16
+
+EVENT_NAMES = {
+    1: "scoop overload",
+    2: "lift overload",
+    3: "low power",
+    4: "profiles repaired",
+    5: "profiles reset",
+    6: "stream overload",
+    7: "ik unreachable",
+}
+
+
+def event_valid(raw):
+    return aflink.crc8(raw[:EVENT_SIZE - 1]) == raw[EVENT_SIZE - 1]
+
+
+def format_event(raw):
+    seq, boot, kind, mode, time_s, current, voltage, _ = aflink.unpack(EVENT_FORMAT, raw)
+    return "boot %3d  %02d:%02d:%02d  %-18s %-22s current=%-4d voltage=%-4d (seq %d)" % (
+        boot, time_s // 3600, time_s // 60 % 60, time_s % 60, EVENT_NAMES.get(kind, "event %d" % kind),
+        aflink.mode_name(mode), current * 4, voltage * 4, seq)
+
+
+def events_from_image(image):
+    raw = [bytes(image[EVENT_LOG_START + 1 + i * EVENT_SIZE:][:EVENT_SIZE]) for i in range(EVENT_LOG_ENTRIES)]
+    valid = [r for r in raw if event_valid(r)]
+    # Oldest first: the entry after the newest one in the ring starts the log
+    if not valid:
+        return []
+    seqs = {r[0] for r in valid}
+    newest = next(r for r in valid if (r[0] + 1) % 256 not in seqs)
+    return sorted(valid, key=lambda r: (r[0] - newest[0] - 1) % 256)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="serial port or EEPROM image")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--clear", action="store_true", help="clear the log after reading it")
+    ap.add_argument("--wait", type=float, default=1.0, help="seconds to wait for the log")
+    args = ap.parse_args()
+
+    if args.source.startswith("/dev/") or args.source.upper().startswith("COM"):
+        port = aflink.open_source(args.source, args.baud)
+        port.write(aflink.encode_frame(aflink.FRAME_CMD_EVENT_LOG, bytes([1 if args.clear else 0])))
+        parser = aflink.FrameParser()
+        deadline = time.time() + args.wait
+        while time.time() < deadline:
+            for frame_type, payload in parser.feed(port.read(256)):
+                if frame_type == aflink.FRAME_EVENT:
+                    print(format_event(payload))
+                elif frame_type == aflink.FRAME_ACK and payload[0] == aflink.FRAME_CMD_EVENT_LOG:
+                    print("device is busy, try again once the arm is waiting at home", file=sys.stderr)
+                    sys.exit(1)
+    else:
+        for raw in events_from_image(aflink.read_eeprom_dump(args.source)):
+            print(format_event(raw))
+
+
+if __name__ == "__main__":
+    main()
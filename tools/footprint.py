@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Reports RAM and flash use of a compiled AutoFeeder, per symbol, and fails if either is over budget.
+
+Usage:
+    arduino-cli compile --fqbn arduino:avr:uno --output-dir build .
+    footprint.py build/AutoFeeder.ino.elf [--ram-budget BYTES] [--flash-budget BYTES] [--top N]
+
+Needs avr-nm and avr-size from the AVR toolchain, found on the PATH or with --prefix.
+Exits with status 1 if RAM or flash is over its budget, so it can gate a build.
+"""
+import argparse
+import subprocess
+import sys
+
+# The ATmega328P data space starts at 0x800000 in the ELF, and EEPROM at 0x810000. Everything below is flash.
+RAM_START = 0x800000
+EEPROM_START = 0x810000
+
+RAM_SIZE = 2048
+FLASH_SIZE = 32256  # 32 KB less the 512 byte bootloader
+RAM_BUDGET = 1536   # Leaves 512 bytes for the stack
+FLASH_BUDGET = FLASH_SIZE
+
+
+def run(tool, *args):
+    return subprocess.run([tool] + list(args), check=True, capture_output=True, text=True).stdout
+
+
+def section_sizes(size_tool, elf):
+    """Returns {section: size} from avr-size -A."""
+    sizes = {}
+    for line in run(size_tool, "-A", elf).splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".") and parts[1].isdigit():
+            sizes[parts[0]] = int(parts[1])
+    return sizes
+
+
+def symbols(nm_tool, elf):
+    """Returns (ram, flash) lists of (size, name), largest first."""
+    ram, flash = [], []
+    for line in run(nm_tool, "-S", "-C", "--size-sort", elf).splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue
+        addr, size, name = int(parts[0], 16), int(parts[1], 16), parts[3]
+        if addr >= EEPROM_START:
+            continue
+        (ram if addr >= RAM_START else flash).append((size, name))
+    ram.sort(reverse=True)
+    flash.sort(reverse=True)
+    return ram, flash
+
+
+def report(title, used, total, budget, syms, top):
+    print("%s: %d of %d bytes (%.0f%%), budget %d" % (title, used, total, 100.0 * used / total, budget))
+    for size, name in syms[:top]:
+        print("  %6d  %s" % (size, name))
+    return used <= budget
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf", help="ELF file from the build")
+    ap.add_argument("--ram-budget", type=int, default=RAM_BUDGET, help="static RAM budget in bytes (default %(default)s)")
+    ap.add_argument("--flash-budget", type=int, default=FLASH_BUDGET, help="flash budget in bytes (default %(default)s)")
+    ap.add_argument("--top", type=int, default=20, help="symbols to list per memory (default %(default)s)")
+    ap.add_argument("--prefix", default="avr-", help="toolchain prefix, may include a directory (default %(default)s)")
+    args = ap.parse_args()
+
+    sizes = section_sizes(args.prefix + "size", args.elf)
+    ram_syms, flash_syms = symbols(args.prefix + "nm", args.elf)
+    # Initialized data takes RAM at run time and flash for its initial values
+    ram_used = sizes.get(".data", 0) + sizes.get(".bss", 0) + sizes.get(".noinit", 0)
+    flash_used = sizes.get(".text", 0) + sizes.get(".data", 0)
+
+    ok = report("RAM", ram_used, RAM_SIZE, args.ram_budget, ram_syms, args.top)
+    print()
+    ok = report("Flash", flash_used, FLASH_SIZE, args.flash_budget, flash_syms, args.top) and ok
+    if not ok:
+        print("\nOver budget", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
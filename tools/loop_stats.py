@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""Prints per-mode loop timing statistics from an AutoFeeder built with LOOP_STATS enabled.
+
+Usage:
+    loop_stats.py /dev/ttyACM0 [--reset]   (requests a dump over the serial port; needs pyserial)
+    loop_stats.py capture.bin              (prints every dump found in a capture)
+"""
+import argparse
+import time
+
+import aflink
+
+# Mirrors LoopStatsFrame in LoopStats.h
+LOOP_STATS_FORMAT = "<BHHHH8B"
+BUCKET_LABELS = ["<128", "<256", "<512", "<1k", "<2k", "<4k", "<8k", ">=8k"]
+
+
+def print_stats(payload):
+    fields = aflink.unpack(LOOP_STATS_FORMAT, payload)
+    mode, min_us, max_us, mean_us, count = fields[:5]
+    buckets = fields[5:]
+    total = sum(buckets) or 1
+    hist = " ".join("%s:%3d%%" % (label, 100 * b // total) for label, b in zip(BUCKET_LABELS, buckets))
+    print("%-22s n=%-5d min=%-5d mean=%-5d max=%-5d us  %s" % (aflink.mode_name(mode), count, min_us, mean_us, max_us, hist))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="serial port or binary capture file")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--reset", action="store_true", help="clear the statistics after the dump")
+    ap.add_argument("--wait", type=float, default=1.0, help="seconds to wait for the dump")
+    args = ap.parse_args()
+
+    src = aflink.open_source(args.source, args.baud)
+    if hasattr(src, "baudrate"):
+        src.write(aflink.encode_frame(aflink.FRAME_CMD_LOOP_STATS, bytes([1 if args.reset else 0])))
+        parser = aflink.FrameParser()
+        deadline = time.time() + args.wait
+        while time.time() < deadline:
+            for frame_type, payload in parser.feed(src.read(256)):
+                if frame_type == aflink.FRAME_LOOP_STATS:
+                    print_stats(payload)
+    else:
+        for frame_type, payload in aflink.read_frames(src):
+            if frame_type == aflink.FRAME_LOOP_STATS:
+                print_stats(payload)
+
+
+if __name__ == "__main__":
+    main()
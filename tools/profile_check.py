@@ -0,0 +1,398 @@
+#!/usr/bin/env python3
+"""Checks AutoFeeder profiles for reach, joint travel, run time and clamped points, and proposes simpler keypoints.
+
+Usage:
+    profile_check.py eeprom.bin [--index N...]     (an EEPROM image, e.g. from avrdude -U eeprom:r:eeprom.bin:r)
+    profile_check.py library.json [--index N...]   (a library from profile_cli.py get)
+    profile_check.py SOURCE --optimize better.json  (also writes the proposed keypoints, for profile_cli.py put)
+
+The scoop is simulated the way scoop_step runs it, without contact with the bowl, so times are lower bounds.
+Scoop and home times count loop iterations, so pass --loop-us from tools/loop_stats.py for realistic times.
+Keypoints are optimized by dropping the ones the path stays within --tolerance mm of without them, after moving clamped
+points to where the arm actually goes. A proposal is only made if it is reachable, and drops points, moves clamped ones
+or shortens the joint travel. Exits with status 1 if a profile is unreachable or has clamped points.
+"""
+import argparse
+import json
+import math
+import struct
+import sys
+
+import aflink
+
+# Mirrors kinematics.h and AutoFeeder.ino
+L1 = 100.0
+L2 = 100.0
+Q1_HOME, Q2_HOME = -3.1415926, 2.1817
+HOME_X, HOME_Y = -42.6424, -81.9152
+Q1_MIN, Q1_MAX = -3.1415926, 0.0
+Q2_MIN, Q2_MAX = 0.0, 3.1415926
+Q_LIMIT_TOLERANCE = 0.001
+IK_STEP_SIZE = 0.25
+MAX_JOINT_SPEED = 0.0003
+RETURN_CLEARANCE = 30.0
+
+# Mirrors MotionPlanner.h
+Q_MAX_SPEED = (1.5, 2.0)
+Q_MAX_ACCEL = (6.0, 8.0)
+LINE_MAX_SPEED = 150.0
+LINE_MAX_ACCEL = 400.0
+LINE_CARRY_ACCEL = 250.0
+LINE_CARRY_JERK = 2500.0
+LINE_MAX_TURN_RATE = 1.2
+LINE_CHECK_POINTS = 8
+LINE_Q1_CLEARANCE = 0.01
+
+# Mirrors Profile.h, and the store layout and location in Profile.cpp and EEPROMMap.h
+NUM_PROFILES = 20
+MIN_PROFILE_POINTS = 2
+MAX_PROFILE_POINTS = 6
+PROFILE_UNITS_PER_MM = 10
+PROFILE_COORD_LIMIT = 2047
+SEGMENT_SPEED_UNITS = 8
+CARRY_ACCEL_UNITS = 50
+CARRY_JERK_UNITS = 500
+EEPROM_PROFILE_START = 0
+EEPROM_PROFILE_LEN = 720
+STORE_MAGIC = 0xAF
+STORE_VERSION = 3
+HEADER_SIZE = 5
+RECORD_FORMAT = "<HBB%dHB" % (MAX_PROFILE_POINTS * 2)
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+IK_OK, IK_UNREACHABLE, IK_JOINT_LIMIT = 0, 1, 2
+CLAMP_REPORT_MM = 0.05  # Clamps smaller than this are rounding
+SLOW_SEGMENT_RATIO = 1.5  # Segments taking this many times the median loops per mm of their profile are reported
+
+
+def calc_fk(q1, q2):
+    return L1 * math.cos(q1) + L2 * math.cos(q1 + q2), L1 * math.sin(q1) + L2 * math.sin(q1 + q2)
+
+
+def constrain_ik_point(x, y):
+    """Returns (x, y) moved into the workspace, as constrain_ik_point() does."""
+    y = min(y, -0.001)
+    min_x = -0.9 * (L1 + L2)
+    x = max(x, min_x)
+    mag = math.hypot(x, y)
+    if mag > L1 + L2:
+        x, y = x * (L1 + L2) / mag, y * (L1 + L2) / mag
+        if y > -0.001:
+            y = -0.001
+            x = math.copysign(math.sqrt((L1 + L2) ** 2 - y * y), x)
+    elif mag < 10:
+        x, y = x * 10 / mag, y * 10 / mag
+    mag = math.hypot(x + L1, y)
+    if mag < L1:
+        x, y = (x + L1) * L1 / mag - L1, y * L1 / mag
+        if x < min_x:
+            x = min_x
+            y = -math.sqrt(L1 * L1 - (x + L1) ** 2)
+        elif x * x + y * y < 100:
+            x = -100 / (2 * L1)
+            y = -math.sqrt(100 - x * x)
+    return x, y
+
+
+def fit_range(q, lo, hi):
+    """Returns (q, clamped) wrapped into a servo range, or None if it is outside, as fit_range() in kinematics.cpp."""
+    if q < lo - Q_LIMIT_TOLERANCE:
+        q += 2 * math.pi
+    elif q > hi + Q_LIMIT_TOLERANCE:
+        q -= 2 * math.pi
+    if q < lo - Q_LIMIT_TOLERANCE or q > hi + Q_LIMIT_TOLERANCE:
+        return None
+    fitted = min(max(q, lo), hi)
+    return fitted, abs(fitted - q)
+
+
+def solve_ik(x, y, q1_cur, q2_cur):
+    """Returns (IK_*, q1, q2), choosing the elbow branch nearest the current joints as solve_ik() does."""
+    d = (x * x + y * y - L1 * L1 - L2 * L2) / (2 * L1 * L2)
+    if not abs(d) <= 1 + 1e-4:
+        return IK_UNREACHABLE, q1_cur, q2_cur
+    d = min(max(d, -1.0), 1.0)
+    best = None
+    for sign in (1, -1):
+        t2 = math.atan2(sign * math.sqrt(1 - d * d), d)
+        t1 = math.atan2(y, x) - math.atan2(L2 * math.sin(t2), L1 + L2 * math.cos(t2))
+        f1, f2 = fit_range(t1, Q1_MIN, Q1_MAX), fit_range(t2, Q2_MIN, Q2_MAX)
+        if f1 is None or f2 is None:
+            continue
+        dist = abs(f1[0] - q1_cur) + abs(f2[0] - q2_cur) + 1000 * (f1[1] + f2[1])
+        if best is None or dist < best[0]:
+            best = (dist, f1[0], f2[0])
+    if best is None:
+        return IK_JOINT_LIMIT, q1_cur, q2_cur
+    return IK_OK, best[1], best[2]
+
+
+def path_time(speed, accel, jerk=0.0):
+    """Duration of a rest to rest move of s from 0 to 1, as time_path() in MotionPlanner.cpp."""
+    if math.isinf(speed) or math.isinf(accel):
+        return 0.0
+    if jerk <= 0:
+        if speed * speed >= accel:
+            return 2 * math.sqrt(1 / accel)
+        return speed / accel + 1 / speed
+    top = 0.5 * (math.sqrt(accel ** 4 / jerk ** 2 + 4 * accel) - accel * accel / jerk)
+    if min(speed, top) * jerk >= accel * accel:
+        speed = min(speed, top)
+        return accel / jerk + speed / accel + 1 / speed
+    speed = min(speed, (0.5 * math.sqrt(jerk)) ** (2 / 3))
+    return 2 * math.sqrt(speed / jerk) + 1 / speed
+
+
+def limit(s_limit, quantity_limit, per_s):
+    return quantity_limit / abs(per_s) if abs(per_s) > 1e-5 and quantity_limit / abs(per_s) < s_limit else s_limit
+
+
+def joint_move_time(q_from, q_to):
+    speed = accel = math.inf
+    for i in range(2):
+        speed = limit(speed, Q_MAX_SPEED[i], q_to[i] - q_from[i])
+        accel = limit(accel, Q_MAX_ACCEL[i], q_to[i] - q_from[i])
+    return path_time(speed, accel)
+
+
+def clears_q1_limit(p_from, p_to):
+    """Returns whether a line stays out of the disk of points that need q1 past -PI, as clears_q1_limit() in MotionPlanner.cpp."""
+    dx, dy = p_to[0] - p_from[0], p_to[1] - p_from[1]
+    length_sq = dx * dx + dy * dy
+    s = min(max(-((p_from[0] + L1) * dx + p_from[1] * dy) / length_sq, 0.0), 1.0) if length_sq > 0 else 0.0
+    return math.hypot(p_from[0] + dx * s + L1, p_from[1] + dy * s) >= L1 - LINE_Q1_CLEARANCE
+
+
+def line_move_time(p_from, p_to, q, accel_limit, jerk_limit):
+    """Returns (seconds, q at the end), or None if the line leaves the workspace, as plan_line() in MotionPlanner.cpp."""
+    if not clears_q1_limit(p_from, p_to):
+        return None
+    rates = [0.0, 0.0, 0.0]
+    for i in range(1, LINE_CHECK_POINTS + 1):
+        s = i / LINE_CHECK_POINTS
+        ok, q1, q2 = solve_ik(p_from[0] + (p_to[0] - p_from[0]) * s, p_from[1] + (p_to[1] - p_from[1]) * s, *q)
+        if ok != IK_OK:
+            return None
+        d1, d2 = (q1 - q[0]) * LINE_CHECK_POINTS, (q2 - q[1]) * LINE_CHECK_POINTS
+        rates = [max(rates[0], abs(d1)), max(rates[1], abs(d2)), max(rates[2], abs(d1 + d2))]
+        q = (q1, q2)
+    length = math.hypot(p_to[0] - p_from[0], p_to[1] - p_from[1])
+    speed = limit(math.inf, LINE_MAX_SPEED, length)
+    speed = limit(limit(limit(speed, Q_MAX_SPEED[0], rates[0]), Q_MAX_SPEED[1], rates[1]), LINE_MAX_TURN_RATE, rates[2])
+    accel = limit(limit(limit(math.inf, accel_limit, length), Q_MAX_ACCEL[0], rates[0]), Q_MAX_ACCEL[1], rates[1])
+    jerk = limit(math.inf, jerk_limit, length) if jerk_limit > 0 else 0
+    return path_time(speed, accel, 0 if math.isinf(jerk) else jerk), q
+
+
+def ik_walk(p_from, p_to, q, step, joint_step):
+    """Steps an IK target along a line as step_ik_target() does, with the joints following at joint_step per loop.
+    Returns (loops, q1 travel, q2 travel, q at the end), or None if a step is unreachable."""
+    loops = 0
+    travel = [0.0, 0.0]
+    length = math.hypot(p_to[0] - p_from[0], p_to[1] - p_from[1])
+    steps = max(1, math.ceil(length / step - 1e-9))
+    for i in range(1, steps + 1):
+        s = min(1.0, i * step / length) if length > 0 else 1.0
+        ok, q1, q2 = solve_ik(p_from[0] + (p_to[0] - p_from[0]) * s, p_from[1] + (p_to[1] - p_from[1]) * s, *q)
+        if ok != IK_OK:
+            return None
+        n = max(1, math.ceil(max(abs(q1 - q[0]), abs(q2 - q[1])) / joint_step - 1e-9))
+        loops += n
+        travel[0] += abs(q1 - q[0])
+        travel[1] += abs(q2 - q[1])
+        q = (q1, q2)
+    return loops, travel[0], travel[1], q
+
+
+def scoop_steps(points):
+    """Targets of the scoop, as get_profile_step(): the keypoints, with the end lifted out of the bowl/plate."""
+    steps = [tuple(p) for p in points]
+    steps[-1] = (steps[-1][0] + 5, steps[-1][1] + 20)
+    return steps
+
+
+def segment_speed(entry, seg):
+    segments = entry.get("segments", [])
+    speed = segments[seg][0] if seg < len(segments) else 0
+    return 1.0 if speed == 0 else speed / SEGMENT_SPEED_UNITS
+
+
+def analyse(entry, loop_s):
+    """Simulates a feeding cycle of a profile. Returns a dict of results, with "error" set if the arm cannot follow it."""
+    points = [constrain_ik_point(*p) for p in entry["points"]]
+    accel, jerk = entry.get("carry", [0, 0])
+    carry_accel = accel * CARRY_ACCEL_UNITS if accel else LINE_CARRY_ACCEL
+    carry_jerk = jerk * CARRY_JERK_UNITS if jerk else LINE_CARRY_JERK
+    result = {"points": points, "clamps": [], "slow": [], "q1_travel": 0.0, "q2_travel": 0.0, "error": None}
+    for i, (orig, fixed) in enumerate(zip(entry["points"], points)):
+        moved = math.hypot(orig[0] - fixed[0], orig[1] - fixed[1])
+        if moved > CLAMP_REPORT_MM:
+            result["clamps"].append((i, moved, fixed))
+
+    q = (Q1_HOME, Q2_HOME)
+    ok, q1, q2 = solve_ik(points[0][0], points[0][1], *q)
+    if ok != IK_OK:
+        result["error"] = "entry point: %s" % ("out of reach" if ok == IK_UNREACHABLE else "joint limit")
+        return result
+    descend = joint_move_time(q, (q1, q2))
+    result["q1_travel"] += abs(q1 - q[0])
+    result["q2_travel"] += abs(q2 - q[1])
+    q, here, scoop_loops, loops_per_mm = (q1, q2), points[0], 0, []
+    for seg, target in enumerate(scoop_steps(points)[1:]):
+        walk = ik_walk(here, target, q, IK_STEP_SIZE * segment_speed(entry, seg), MAX_JOINT_SPEED)
+        if walk is None:
+            result["error"] = "segment %d leaves the workspace" % seg
+            return result
+        loops, t1, t2, q = walk
+        scoop_loops += loops
+        result["q1_travel"] += t1
+        result["q2_travel"] += t2
+        loops_per_mm.append(loops / max(math.dist(here, target), IK_STEP_SIZE))
+        here = target
+    # Segments near the shoulder or the edge of reach need much more joint motion per mm, which the joint speed limit slows
+    median = sorted(loops_per_mm)[len(loops_per_mm) // 2]
+    result["slow"] = [(seg, rate / median) for seg, rate in enumerate(loops_per_mm) if rate > SLOW_SEGMENT_RATIO * median]
+
+    lift = line_move_time(here, (L1 + L2, 0.0), q, carry_accel, carry_jerk)
+    lift_end = (0.0, 0.0)
+    lift_s = lift[0] if lift else joint_move_time(q, lift_end)
+    back = constrain_ik_point(points[-1][0], points[-1][1] + RETURN_CLEARANCE)
+    ok, r1, r2 = solve_ik(back[0], back[1], *lift_end)
+    ret = line_move_time((L1 + L2, 0.0), back, lift_end, LINE_MAX_ACCEL, 0) if ok == IK_OK else None
+    ret_s = ret[0] if ret else 0.0
+    home = ik_walk(back, (HOME_X, HOME_Y), (r1, r2), IK_STEP_SIZE, MAX_JOINT_SPEED * 4)
+    home_s = home[0] * loop_s if home else 0.0
+    result["times"] = {"descend": descend, "scoop": scoop_loops * loop_s, "lift": lift_s, "return": ret_s, "home": home_s}
+    return result
+
+
+def rdp(points, tolerance):
+    """Indices of the points Ramer-Douglas-Peucker keeps: the ends, and every point further than tolerance from the line
+    between its kept neighbours."""
+    def dist(p, a, b):
+        dx, dy = b[0] - a[0], b[1] - a[1]
+        length_sq = dx * dx + dy * dy
+        t = 0 if length_sq == 0 else max(0.0, min(1.0, ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / length_sq))
+        return math.hypot(p[0] - a[0] - t * dx, p[1] - a[1] - t * dy)
+
+    def keep(lo, hi):
+        if hi - lo < 2:
+            return []
+        far = max(range(lo + 1, hi), key=lambda i: dist(points[i], points[lo], points[hi]))
+        if dist(points[far], points[lo], points[hi]) <= tolerance:
+            return []
+        return keep(lo, far) + [far] + keep(far, hi)
+
+    return [0] + keep(0, len(points) - 1) + [len(points) - 1]
+
+
+def optimize(entry, result, tolerance):
+    """Proposes keypoints that cover the same path within tolerance. A merged segment keeps the settings of its longest part."""
+    points = result["points"]
+    kept = rdp(points, tolerance)
+    old_segments = entry.get("segments", [])
+    segments = []
+    for a, b in zip(kept, kept[1:]):
+        longest = max(range(a, b), key=lambda i: math.dist(points[i], points[i + 1]))
+        segments.append(old_segments[longest] if longest < len(old_segments) else [0, 0])
+    return {
+        "points": [[round(x * PROFILE_UNITS_PER_MM) / PROFILE_UNITS_PER_MM, round(y * PROFILE_UNITS_PER_MM) / PROFILE_UNITS_PER_MM]
+                   for x, y in (points[i] for i in kept)],
+        "segments": segments,
+        "carry": entry.get("carry", [0, 0]),
+    }
+
+
+def profiles_from_image(image):
+    """Returns {index: entry} of the live profiles in an EEPROM image, as load_profiles() finds them."""
+    header = image[EEPROM_PROFILE_START:EEPROM_PROFILE_START + HEADER_SIZE]
+    if header[0] != STORE_MAGIC or header[1] != STORE_VERSION or header[2] != RECORD_SIZE or \
+            header[4] != aflink.crc8(header[:4]):
+        sys.exit("no profile store in the image, or it is from another version")
+    live = {}
+    for slot in range(header[3]):
+        start = EEPROM_PROFILE_START + HEADER_SIZE + slot * RECORD_SIZE
+        raw = bytes(image[start:start + RECORD_SIZE])
+        seq, idx, n, *words = struct.unpack(RECORD_FORMAT, raw)
+        crc = words.pop()
+        if seq == 0xFFFF or idx >= NUM_PROFILES or not MIN_PROFILE_POINTS <= n <= MAX_PROFILE_POINTS:
+            continue
+        if crc != aflink.crc8(raw[:-1]) or (idx in live and live[idx][0] >= seq):
+            continue
+        # 12 bit coordinates, with the nibbles of the segment starting at each point (of the carry byte at the last point)
+        coords = [((w & 0x0FFF) ^ 0x0800) - 0x0800 for w in words]
+        nibbles = [w >> 12 for w in words]
+        segs = [nibbles[2 * i] << 4 | nibbles[2 * i + 1] for i in range(n)]
+        live[idx] = (seq, {
+            "points": [[coords[2 * i] / PROFILE_UNITS_PER_MM, coords[2 * i + 1] / PROFILE_UNITS_PER_MM] for i in range(n)],
+            "segments": [[b >> 4, b & 0x0F] for b in segs[:n - 1]],
+            "carry": [segs[n - 1] >> 4, segs[n - 1] & 0x0F],
+        })
+    return {idx: entry for idx, (_, entry) in live.items()}
+
+
+def report(idx, entry, result, proposal):
+    total = sum(result["times"].values()) if not result["error"] else 0
+    print("profile %d: %d points" % (idx, len(entry["points"])))
+    for i, moved, (x, y) in result["clamps"]:
+        print("  point %d is clamped by %.1f mm to (%.1f, %.1f)" % (i, moved, x, y))
+    if result["error"]:
+        print("  UNREACHABLE: %s" % result["error"])
+        return
+    for seg, ratio in result["slow"]:
+        print("  segment %d is slow, it takes %.1fx the loops per mm of the profile's median segment" % (seg, ratio))
+    print("  joint travel q1 %.2f rad, q2 %.2f rad" % (result["q1_travel"], result["q2_travel"]))
+    print("  cycle %.1f s (%s)" % (total, ", ".join("%s %.1f" % kv for kv in result["times"].items())))
+    if proposal:
+        new_entry, new_result = proposal
+        print("  proposed %d points, joint travel q1 %.2f rad, q2 %.2f rad, cycle %.1f s: %s" % (
+            len(new_entry["points"]), new_result["q1_travel"], new_result["q2_travel"], sum(new_result["times"].values()),
+            " ".join("(%g, %g)" % tuple(p) for p in new_entry["points"])))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="EEPROM image, or JSON library from profile_cli.py")
+    ap.add_argument("--index", type=int, nargs="*", help="profiles to check (default all)")
+    ap.add_argument("--loop-us", type=float, default=1000, help="mean loop iteration time in scoop_step (default %(default)s)")
+    ap.add_argument("--tolerance", type=float, default=2.0, help="how far in mm the optimized path may stray (default %(default)s)")
+    ap.add_argument("--optimize", metavar="JSON", help="write the proposed profiles to this library file")
+    args = ap.parse_args()
+
+    if args.source.endswith(".json"):
+        with open(args.source) as f:
+            library = {int(idx): entry for idx, entry in json.load(f)["profiles"].items()}
+    else:
+        library = profiles_from_image(aflink.read_eeprom_dump(args.source))
+
+    proposals = {}
+    bad = False
+    for idx in sorted(args.index if args.index is not None else library):
+        if idx not in library:
+            print("profile %d: not found" % idx)
+            bad = True
+            continue
+        entry = library[idx]
+        result = analyse(entry, args.loop_us * 1e-6)
+        proposal = None
+        if not result["error"]:
+            new_entry = optimize(entry, result, args.tolerance)
+            new_result = analyse(new_entry, args.loop_us * 1e-6)
+            old_travel = result["q1_travel"] + result["q2_travel"]
+            if not new_result["error"] and (new_result["q1_travel"] + new_result["q2_travel"] < old_travel - 1e-3
+                                            or len(new_entry["points"]) < len(entry["points"]) or result["clamps"]):
+                proposal = (new_entry, new_result)
+                proposals[str(idx)] = new_entry
+        bad = bad or bool(result["error"] or result["clamps"])
+        report(idx, entry, result, proposal)
+
+    if args.optimize:
+        with open(args.optimize, "w") as f:
+            json.dump({"profiles": proposals}, f, indent=2)
+            f.write("\n")
+        print("wrote %d proposed profiles to %s" % (len(proposals), args.optimize))
+    sys.exit(1 if bad else 0)
+
+
+if __name__ == "__main__":
+    main()
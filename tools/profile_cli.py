@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Reads and writes AutoFeeder profiles and servo calibration over the serial port (needs pyserial).
+
+Usage:
+    profile_cli.py PORT list
+    profile_cli.py PORT get [INDEX...] > library.json
+    profile_cli.py PORT put library.json
+    profile_cli.py PORT activate INDEX
+    profile_cli.py PORT cal-get > cal.json
+    profile_cli.py PORT cal-put cal.json
+
+A library is JSON: {"profiles": {"INDEX": {"points": [[x_mm, y_mm], ...], "segments": [[speed, force], ...], "carry": [accel, jerk]}}}.
+Segment speed and force, and the carry acceleration and jerk limits, are 0..15, where 0 means the default (see Profile.h).
+Writes are sent inside one transaction, which the device only accepts while it waits at home. Activation is also refused while the arm moves.
+The device saves each write as it arrives, so put and cal-put first read back everything they are about to overwrite. If a write
+is refused or goes unanswered, the snapshot is written back, so the device is left with the old library or tables, not part of the new.
+If the link is lost for good, the snapshot cannot be sent; it is then saved next to the input file, and can be sent with put or cal-put.
+"""
+import argparse
+import json
+import struct
+import sys
+import time
+
+import aflink
+
+# Mirrors Profile.h
+NUM_PROFILES = 20
+MAX_PROFILE_POINTS = 6
+MIN_PROFILE_POINTS = 2
+PROFILE_UNITS_PER_MM = 10
+PROFILE_COORD_LIMIT = 2047
+SERVO_CAL_POINTS = 7
+
+
+def encode_profile(entry):
+    points = entry["points"]
+    if not MIN_PROFILE_POINTS <= len(points) <= MAX_PROFILE_POINTS:
+        raise ValueError("a profile needs %d to %d points" % (MIN_PROFILE_POINTS, MAX_PROFILE_POINTS))
+    out = bytearray([len(points)])
+    for x, y in points:
+        units = [int(round(v * PROFILE_UNITS_PER_MM)) for v in (x, y)]
+        if any(abs(u) > PROFILE_COORD_LIMIT for u in units):
+            raise ValueError("point (%g, %g) is out of range" % (x, y))
+        out += struct.pack("<hh", *units)
+    segments = entry.get("segments", [])
+    segments = segments + [[0, 0]] * (len(points) - 1 - len(segments))
+    for speed, force in segments[:len(points) - 1]:
+        out.append((speed & 0x0F) << 4 | (force & 0x0F))
+    accel, jerk = entry.get("carry", [0, 0])
+    out.append((accel & 0x0F) << 4 | (jerk & 0x0F))
+    return bytes(out)
+
+
+def decode_profile(data):
+    n = data[0]
+    points = [[v / PROFILE_UNITS_PER_MM for v in struct.unpack_from("<hh", data, 1 + i * 4)] for i in range(n)]
+    segments = [[b >> 4, b & 0x0F] for b in data[1 + n * 4:1 + n * 4 + n - 1]]
+    carry = data[1 + n * 4 + n - 1] if len(data) > 1 + n * 4 + n - 1 else 0
+    return {"points": points, "segments": segments, "carry": [carry >> 4, carry & 0x0F]}
+
+
+class DeviceError(Exception):
+    pass
+
+
+class Device:
+    def __init__(self, path, baud, boot_wait):
+        self.port = aflink.open_source(path, baud)
+        self.parser = aflink.FrameParser()
+        time.sleep(boot_wait)  # Opening the port resets the board
+
+    def request(self, frame_type, payload=b"", reply_types=(aflink.FRAME_ACK,)):
+        reply = aflink.request(self.port, frame_type, payload, reply_types, parser=self.parser)
+        if reply is None:
+            raise DeviceError("no reply to command 0x%02X" % frame_type)
+        if reply[0] == aflink.FRAME_ACK and reply[1][1] != 0:
+            status = reply[1][1]
+            raise DeviceError("command 0x%02X failed: %s" % (
+                frame_type, aflink.ACK_NAMES[status] if status < len(aflink.ACK_NAMES) else status))
+        return reply[1]
+
+    def read_profile(self, idx):
+        return decode_profile(self.request(aflink.FRAME_CMD_READ_PROFILE, bytes([idx]), (aflink.FRAME_PROFILE, aflink.FRAME_ACK))[1:])
+
+    def read_cal(self, servo):
+        reply = self.request(aflink.FRAME_CMD_READ_CAL, bytes([servo]), (aflink.FRAME_SERVO_CAL, aflink.FRAME_ACK))
+        return list(struct.unpack_from("<%dH" % SERVO_CAL_POINTS, reply, 1))
+
+    def write_transaction(self, frame_type, writes, sent=None):
+        """Sends (payload, description) writes of one command type inside a BEGIN/END transaction.
+        The index of each write is appended to sent before it is sent, since a write may be saved even if its reply is lost."""
+        self.request(aflink.FRAME_CMD_BEGIN)
+        try:
+            for i, (payload, description) in enumerate(writes):
+                if sent is not None:
+                    sent.append(i)
+                self.request(frame_type, payload)
+                print("wrote %s" % description, file=sys.stderr)
+        except DeviceError:
+            try:
+                self.request(aflink.FRAME_CMD_END)
+            except DeviceError:
+                pass  # The write error is the one to report, and host_mode ends by itself after HOST_MODE_TIMEOUT
+            raise
+        self.request(aflink.FRAME_CMD_END)
+
+    def write_all_or_restore(self, frame_type, writes, snapshot, snapshot_json, path):
+        """Sends the writes in one transaction. If any fails, the writes that were sent are undone with the matching entries of
+        snapshot, which holds the same writes with the old contents."""
+        sent = []
+        try:
+            self.write_transaction(frame_type, writes, sent)
+        except DeviceError as e:
+            if not sent:
+                raise  # The transaction was refused, and nothing was written
+            print("%s, restoring the previous contents" % e, file=sys.stderr)
+            try:
+                self.write_transaction(frame_type, [snapshot[i] for i in sent])
+            except DeviceError as e2:
+                backup = path + ".restore.json"
+                with open(backup, "w") as f:
+                    json.dump(snapshot_json, f, indent=2)
+                sys.exit("restoring failed (%s), the device may hold part of %s. The previous contents are in %s" % (e2, path, backup))
+            sys.exit("nothing was changed")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port", help="serial port")
+    ap.add_argument("command", choices=["list", "get", "put", "activate", "cal-get", "cal-put"])
+    ap.add_argument("args", nargs="*")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--boot-wait", type=float, default=2.0, help="seconds to wait for the board to reset")
+    args = ap.parse_args()
+    try:
+        run(args)
+    except DeviceError as e:
+        sys.exit(str(e))
+
+
+def run(args):
+    dev = Device(args.port, args.baud, args.boot_wait)
+
+    if args.command == "list":
+        reply = dev.request(aflink.FRAME_CMD_LIST, b"", (aflink.FRAME_PROFILE_LIST,))
+        for idx, n in enumerate(reply[1:]):
+            print("%s %2d  bank %d  %d points" % ("*" if idx == reply[0] else " ", idx, idx // 4, n))
+    elif args.command == "get":
+        indices = [int(a) for a in args.args] or range(NUM_PROFILES)
+        library = {"profiles": {str(i): dev.read_profile(i) for i in indices}}
+        json.dump(library, sys.stdout, indent=2)
+        print()
+    elif args.command == "put":
+        with open(args.args[0]) as f:
+            library = json.load(f)
+        frames = [(int(idx), encode_profile(entry)) for idx, entry in library["profiles"].items()]
+        old = {str(idx): dev.read_profile(idx) for idx, _ in frames}
+        writes = [(bytes([idx]) + data, "profile %d" % idx) for idx, data in frames]
+        snapshot = [(bytes([int(idx)]) + encode_profile(entry), "previous profile %s" % idx) for idx, entry in old.items()]
+        dev.write_all_or_restore(aflink.FRAME_CMD_WRITE_PROFILE, writes, snapshot, {"profiles": old}, args.args[0])
+    elif args.command == "activate":
+        dev.request(aflink.FRAME_CMD_ACTIVATE, bytes([int(args.args[0])]))
+    elif args.command == "cal-get":
+        json.dump({"servos": [dev.read_cal(0), dev.read_cal(1)]}, sys.stdout)
+        print()
+    elif args.command == "cal-put":
+        with open(args.args[0]) as f:
+            servos = json.load(f)["servos"]
+        old = [dev.read_cal(0), dev.read_cal(1)]
+        pack = lambda servo, table: bytes([servo]) + struct.pack("<%dH" % SERVO_CAL_POINTS, *table)
+        writes = [(pack(servo, table), "servo %d calibration" % servo) for servo, table in enumerate(servos)]
+        snapshot = [(pack(servo, table), "previous servo %d calibration" % servo) for servo, table in enumerate(old)]
+        dev.write_all_or_restore(aflink.FRAME_CMD_WRITE_CAL, writes, snapshot, {"servos": old}, args.args[0])
+
+
+if __name__ == "__main__":
+    main()
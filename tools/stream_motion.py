@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Streams a trajectory to the AutoFeeder's stream_mode over the serial port (needs pyserial).
+
+Usage:
+    stream_motion.py /dev/ttyACM0 trajectory.csv [--joint]
+
+The CSV has one setpoint per line: t_ms,x_mm,y_mm (or t_ms,q1_rad,q2_rad with --joint), with t_ms increasing
+from the start of the stream. Lines starting with # are ignored. The arm must be waiting at home; it returns
+home when the stream ends.
+"""
+import argparse
+import struct
+import sys
+import time
+
+import aflink
+
+# Mirrors MotionStream.h
+STREAM_BUFFER_SIZE = 16
+STREAM_JOINT = 0x01
+SETPOINT_FORMAT = "<Hhh"
+SETPOINT_SIZE = 6
+STATUS_FORMAT = "<BBH"
+PER_FRAME = (aflink.FRAME_MAX_PAYLOAD - 1) // SETPOINT_SIZE
+
+
+def read_trajectory(path, joint):
+    scale = 1000 if joint else 10  # mrad, or 0.1 mm
+    setpoints, prev_t = [], 0
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            t, a, b = (float(v) for v in line.split(","))
+            setpoints.append(struct.pack(SETPOINT_FORMAT, int(round(t - prev_t)), int(round(a * scale)), int(round(b * scale))))
+            prev_t = t
+    return setpoints
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("port", help="serial port")
+    ap.add_argument("trajectory", help="CSV file of setpoints")
+    ap.add_argument("--joint", action="store_true", help="setpoints are joint angles in radians")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--boot-wait", type=float, default=2.0, help="seconds to wait for the board to reset")
+    args = ap.parse_args()
+
+    setpoints = read_trajectory(args.trajectory, args.joint)
+    port = aflink.open_source(args.port, args.baud)
+    time.sleep(args.boot_wait)  # Opening the port resets the board
+    parser = aflink.FrameParser()
+    flags = bytes([STREAM_JOINT if args.joint else 0])
+    sent, space, underruns = 0, 1, 0
+    try:
+        while sent < len(setpoints):
+            # Never send more than the device has room for; poll with an empty frame while it is full
+            batch = setpoints[sent:sent + min(space, PER_FRAME)]
+            reply = aflink.request(port, aflink.FRAME_CMD_STREAM, flags + b"".join(batch),
+                                   (aflink.FRAME_STREAM_STATUS, aflink.FRAME_ACK), parser=parser)
+            if reply is None:
+                sys.exit("no reply from the device")
+            if reply[0] == aflink.FRAME_ACK:
+                sys.exit("stream refused: %s" % aflink.ACK_NAMES[reply[1][1]])
+            accepted, space, underruns = aflink.unpack(STATUS_FORMAT, reply[1])
+            if accepted < len(batch) and space > 0:
+                sys.exit("setpoint %d is unreachable" % (sent + accepted))
+            sent += accepted
+            if space == 0:
+                time.sleep(0.02)
+        # Wait for the buffer to drain before ending the stream
+        while space < STREAM_BUFFER_SIZE:
+            time.sleep(0.05)
+            reply = aflink.request(port, aflink.FRAME_CMD_STREAM, flags, (aflink.FRAME_STREAM_STATUS,), parser=parser)
+            if reply:
+                _, space, underruns = aflink.unpack(STATUS_FORMAT, reply[1])
+        if setpoints:
+            time.sleep(struct.unpack(SETPOINT_FORMAT, setpoints[-1])[0] / 1000.0)  # The last setpoint is still running
+    finally:
+        aflink.request(port, aflink.FRAME_CMD_END, parser=parser)
+    print("sent %d setpoints, %d underruns" % (sent, underruns))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Decodes AutoFeeder telemetry frames into CSV.
+
+Usage:
+    telemetry_decode.py capture.bin > telemetry.csv
+    telemetry_decode.py /dev/ttyACM0 > telemetry.csv    (live, stop with Ctrl+C; needs pyserial)
+    telemetry_decode.py /dev/ttyACM0 --interval 20      (sets the time between frames first, 0 stops telemetry)
+"""
+import argparse
+import csv
+import struct
+import sys
+
+import aflink
+
+# Mirrors TelemetryFrame in AutoFeeder.ino
+TELEMETRY_FORMAT = "<HhhhhHHBH"
+COLUMNS = ["time_ms", "q1_rad", "q2_rad", "ik_x_mm", "ik_y_mm", "servo_current", "motor_current", "mode", "loop_us"]
+
+
+def decode_telemetry(payload):
+    t, q1, q2, x, y, servo_i, motor_i, mode, loop_us = aflink.unpack(TELEMETRY_FORMAT, payload)
+    return [t, q1 / 1000.0, q2 / 1000.0, x / 10.0, y / 10.0, servo_i, motor_i, aflink.mode_name(mode), loop_us]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="binary capture file or serial port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--interval", type=int, help="ms between telemetry frames, until the device resets; 0 stops telemetry")
+    args = ap.parse_args()
+
+    parser = aflink.FrameParser()
+    src = aflink.open_source(args.source, args.baud)
+    if args.interval is not None:
+        if not hasattr(src, "baudrate"):
+            sys.exit("--interval needs a serial port")
+        if not 0 <= args.interval <= 0xFFFF:
+            sys.exit("--interval must be 0 to 65535 ms")
+        reply = aflink.request(src, aflink.FRAME_CMD_TELEMETRY, struct.pack("<H", args.interval), parser=parser)
+        if reply is None:
+            sys.exit("no reply from the device")
+        if reply[1][1] != 0:
+            sys.exit("the device refused the telemetry interval: %s" % aflink.ACK_NAMES[reply[1][1]])
+        if args.interval == 0:
+            return
+
+    out = csv.writer(sys.stdout)
+    out.writerow(COLUMNS)
+    try:
+        for frame_type, payload in aflink.read_frames(src, parser):
+            if frame_type == aflink.FRAME_TELEMETRY:
+                out.writerow(decode_telemetry(payload))
+    except KeyboardInterrupt:
+        pass
+    if parser.bad_frames:
+        print("%d corrupted frames skipped" % parser.bad_frames, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()